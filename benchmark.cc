@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "outro_sort/outro_sort.h"
+#include "quicksort.hh"
+#include "sort.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// A benchmarked algorithm. It either sorts the vector, or returns its median
+/// (possibly reordering it).
+///////////////////////////////////////////////////////////////////////////////
+struct Algorithm
+{
+    char const *name;
+    bool quadratic;
+    bool sorts;
+    int (*run)(std::vector<int>& vec);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Run a sort function from `sort.c`, which reports failure by returning a
+/// nonzero value.
+///////////////////////////////////////////////////////////////////////////////
+template <bool sort(dtype *, int)>
+int run_sort_c(std::vector<int>& vec)
+{
+    if(sort(vec.data(), static_cast<int>(vec.size())))
+    {
+        throw std::runtime_error("Sort function failed!");
+    }
+    return 0;
+}
+
+int run_outro_sort(std::vector<int>& vec)
+{
+    outro_sort(vec.data(), vec.data() + vec.size());
+    return 0;
+}
+
+int run_std_sort(std::vector<int>& vec)
+{
+    std::sort(vec.begin(), vec.end());
+    return 0;
+}
+
+int run_stable_sort(std::vector<int>& vec)
+{
+    if(stable_sort(vec.data(), vec.data() + vec.size()) != 0)
+    {
+        throw std::runtime_error("Sort function failed!");
+    }
+    return 0;
+}
+
+int run_std_stable_sort(std::vector<int>& vec)
+{
+    std::stable_sort(vec.begin(), vec.end());
+    return 0;
+}
+
+int run_quickselect(std::vector<int>& vec)
+{
+    return quickselect(vec, vec.size() / 2);
+}
+
+int run_quickselect_inplace(std::vector<int>& vec)
+{
+    return quickselect_inplace(vec, vec.size() / 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Select the median and the tail quantiles monitoring typically needs, all at
+/// once.
+///////////////////////////////////////////////////////////////////////////////
+std::vector<size_t> quantile_positions(size_t size)
+{
+    std::vector<size_t> positions;
+    for(double quantile: {0.5, 0.9, 0.99, 0.999})
+    {
+        positions.push_back(std::max(size / 2, static_cast<size_t>(quantile * (size - 1))));
+    }
+    return positions;
+}
+
+int run_quantiles(std::vector<int>& vec)
+{
+    return quickselect(vec, quantile_positions(vec.size()))[0];
+}
+
+int run_quantiles_parallel(std::vector<int>& vec)
+{
+    return quickselect_parallel(vec, quantile_positions(vec.size()))[0];
+}
+
+int run_outro_nth_element(std::vector<int>& vec)
+{
+    outro_nth_element(vec.data(), vec.data() + vec.size() / 2, vec.data() + vec.size());
+    return vec[vec.size() / 2];
+}
+
+int run_nth_element(std::vector<int>& vec)
+{
+    std::nth_element(vec.begin(), vec.begin() + vec.size() / 2, vec.end());
+    return vec[vec.size() / 2];
+}
+
+Algorithm const algorithms[] =
+{
+    {"bubble_sort", true, true, run_sort_c<bubble_sort>},
+    {"selection_sort", true, true, run_sort_c<selection_sort>},
+    {"merge_sort", false, true, run_sort_c<merge_sort>},
+    {"heap_sort", false, true, run_sort_c<heap_sort>},
+    {"outro_sort", false, true, run_outro_sort},
+    {"std::sort", false, true, run_std_sort},
+    {"stable_sort", false, true, run_stable_sort},
+    {"std::stable_sort", false, true, run_std_stable_sort},
+    {"quickselect", false, false, run_quickselect},
+    {"quickselect_inplace", false, false, run_quickselect_inplace},
+    {"quantiles", false, false, run_quantiles},
+    {"quantiles_parallel", false, false, run_quantiles_parallel},
+    {"outro_nth_element", false, false, run_outro_nth_element},
+    {"std::nth_element", false, false, run_nth_element},
+};
+int constexpr num_algorithms = sizeof algorithms / sizeof *algorithms;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Input distributions.
+///////////////////////////////////////////////////////////////////////////////
+char const *distributions[] =
+{
+    "random",
+    "sorted",
+    "reversed",
+    "sawtooth",
+    "few-unique",
+    "zipf",
+};
+int constexpr num_distributions = sizeof distributions / sizeof *distributions;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Fill a vector with values from a distribution. The same seed produces the
+/// same values.
+///////////////////////////////////////////////////////////////////////////////
+void fill(std::vector<int>& vec, int distribution, std::uint64_t seed)
+{
+    std::mt19937_64 mersenne(seed);
+    std::size_t size = vec.size();
+    switch(distribution)
+    {
+        case 0:
+        {
+            std::uniform_int_distribution<int> uniform(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+            std::generate(vec.begin(), vec.end(), [&](){ return uniform(mersenne); });
+            break;
+        }
+        case 1:
+        case 2:
+            for(std::size_t i = 0; i < size; ++i)
+            {
+                vec[i] = distribution == 1 ? static_cast<int>(i) : static_cast<int>(size - i);
+            }
+            break;
+        case 3:
+        {
+            // Sixteen ascending runs.
+            std::size_t period = size / 16 + 1;
+            for(std::size_t i = 0; i < size; ++i)
+            {
+                vec[i] = static_cast<int>(i % period);
+            }
+            break;
+        }
+        case 4:
+        {
+            std::uniform_int_distribution<int> uniform(0, 15);
+            std::generate(vec.begin(), vec.end(), [&](){ return uniform(mersenne); });
+            break;
+        }
+        case 5:
+        {
+            // Value k is drawn with probability proportional to 1 / k.
+            std::size_t num_values = std::min<std::size_t>(size, 1U << 20);
+            std::vector<double> weights(num_values);
+            for(std::size_t k = 0; k < num_values; ++k)
+            {
+                weights[k] = 1.0 / (k + 1);
+            }
+            std::discrete_distribution<int> zipf(weights.begin(), weights.end());
+            std::generate(vec.begin(), vec.end(), [&](){ return zipf(mersenne); });
+            break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Read the monotonic clock, which (unlike `clock`) measures wall time, and
+/// therefore accounts for threads.
+///////////////////////////////////////////////////////////////////////////////
+long long now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Summary of the running times of one algorithm on one input.
+///////////////////////////////////////////////////////////////////////////////
+struct Result
+{
+    long long min_ns;
+    long long median_ns;
+    long long p95_ns;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Time an algorithm on a copy of the input, discarding the first few runs.
+/// Every result is checked against the sorted input.
+///////////////////////////////////////////////////////////////////////////////
+Result measure(Algorithm const& algorithm, std::vector<int> const& input, std::vector<int> const& sorted, int warmup, int repetitions)
+{
+    std::vector<int> vec(input.size());
+    std::vector<long long> samples;
+    for(int i = 0; i < warmup + repetitions; ++i)
+    {
+        std::copy(input.begin(), input.end(), vec.begin());
+        long long start = now();
+        int median = algorithm.run(vec);
+        long long stop = now();
+        if(algorithm.sorts ? vec != sorted : median != sorted[sorted.size() / 2])
+        {
+            throw std::runtime_error(std::string("Wrong result obtained from ") + algorithm.name + "!");
+        }
+        if(i >= warmup)
+        {
+            samples.push_back(stop - start);
+        }
+    }
+
+    // The 95th percentile uses the nearest-rank method.
+    std::sort(samples.begin(), samples.end());
+    std::size_t count = samples.size();
+    long long median = count % 2 == 1 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    std::size_t rank = static_cast<std::size_t>(std::ceil(0.95 * count));
+    return {samples.front(), median, samples[rank - 1]};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Select items by name from a comma-separated list. Return false if any name
+/// is not recognised.
+///////////////////////////////////////////////////////////////////////////////
+bool select_names(char const *list, std::vector<bool>& selected, int num_names, char const *name(int))
+{
+    std::fill(selected.begin(), selected.end(), false);
+    std::string names(list);
+    std::size_t begin = 0;
+    while(begin <= names.size())
+    {
+        std::size_t end = std::min(names.find(',', begin), names.size());
+        std::string item = names.substr(begin, end - begin);
+        bool found = false;
+        for(int i = 0; i < num_names; ++i)
+        {
+            if(item == name(i))
+            {
+                selected[i] = found = true;
+            }
+        }
+        if(!found)
+        {
+            return false;
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
+char const *algorithm_name(int i)
+{
+    return algorithms[i].name;
+}
+
+char const *distribution_name(int i)
+{
+    return distributions[i];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Display the usage.
+///////////////////////////////////////////////////////////////////////////////
+void usage(void)
+{
+    std::printf("usage:\n");
+    std::printf("\t./benchmark [options]\n");
+    std::printf("\t-a\tcomma-separated algorithms (default: all)\n");
+    std::printf("\t-d\tcomma-separated distributions (default: all)\n");
+    std::printf("\t-s\tbase-2 logarithm of the smallest size (default: 10)\n");
+    std::printf("\t-S\tbase-2 logarithm of the largest size (default: 26)\n");
+    std::printf("\t-q\tbase-2 logarithm of the largest size for quadratic algorithms (default: 14)\n");
+    std::printf("\t-w\tnumber of warmup runs (default: 1)\n");
+    std::printf("\t-r\tnumber of timed runs (default: 5)\n");
+    std::printf("\t-x\tseed (default: 1)\n");
+    std::printf("\t-p\tstart a pool of this many threads for outro_sort (default: a thread per subarray)\n");
+    std::printf("\t-f\toutput format: csv (default) or json\n");
+    std::printf("algorithms:");
+    for(auto const& algorithm: algorithms)
+    {
+        std::printf(" %s", algorithm.name);
+    }
+    std::printf("\ndistributions:");
+    for(auto const& distribution: distributions)
+    {
+        std::printf(" %s", distribution);
+    }
+    std::printf("\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Main function.
+///////////////////////////////////////////////////////////////////////////////
+int main(int const argc, char **argv)
+{
+    std::vector<bool> algorithm_selected(num_algorithms, true);
+    std::vector<bool> distribution_selected(num_distributions, true);
+    int min_log_size = 10, max_log_size = 26, max_log_size_quadratic = 14;
+    int warmup = 1, repetitions = 5, num_workers = 0;
+    std::uint64_t seed = 1;
+    bool json = false;
+    int option;
+    while((option = getopt(argc, argv, "a:d:s:S:q:w:r:x:p:f:")) != -1)
+    {
+        bool valid = true;
+        switch(option)
+        {
+            case 'a':
+                valid = select_names(optarg, algorithm_selected, num_algorithms, algorithm_name);
+                break;
+            case 'd':
+                valid = select_names(optarg, distribution_selected, num_distributions, distribution_name);
+                break;
+            case 's':
+                min_log_size = std::atoi(optarg);
+                break;
+            case 'S':
+                max_log_size = std::atoi(optarg);
+                break;
+            case 'q':
+                max_log_size_quadratic = std::atoi(optarg);
+                break;
+            case 'w':
+                warmup = std::atoi(optarg);
+                break;
+            case 'r':
+                repetitions = std::atoi(optarg);
+                break;
+            case 'x':
+                seed = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 'p':
+                num_workers = std::atoi(optarg);
+                break;
+            case 'f':
+                json = std::strcmp(optarg, "json") == 0;
+                valid = json || std::strcmp(optarg, "csv") == 0;
+                break;
+            default:
+                valid = false;
+        }
+        if(!valid)
+        {
+            usage();
+            return 1;
+        }
+    }
+    if(optind != argc || min_log_size < 0 || max_log_size > 30 || warmup < 0 || repetitions < 1)
+    {
+        usage();
+        return 1;
+    }
+    if(num_workers > 0 && outro_sort_init(num_workers) != 0)
+    {
+        std::fprintf(stderr, "Could not start the thread pool.\n");
+        return 2;
+    }
+
+    // Results are written as soon as they are available, so that a partial
+    // run is still useful.
+    std::printf(json ? "[" : "algorithm,distribution,size,repetitions,min_ns,median_ns,p95_ns\n");
+    char const *separator = "\n";
+    int status = 0;
+    try
+    {
+        for(int d = 0; d < num_distributions; ++d)
+        {
+            if(!distribution_selected[d])
+            {
+                continue;
+            }
+            for(int log_size = min_log_size; log_size <= max_log_size; ++log_size)
+            {
+                std::vector<int> input(std::size_t(1) << log_size);
+                fill(input, d, seed + log_size);
+                std::vector<int> sorted(input);
+                std::sort(sorted.begin(), sorted.end());
+                for(int a = 0; a < num_algorithms; ++a)
+                {
+                    Algorithm const& algorithm = algorithms[a];
+                    if(!algorithm_selected[a] || (algorithm.quadratic && log_size > max_log_size_quadratic))
+                    {
+                        continue;
+                    }
+                    Result result = measure(algorithm, input, sorted, warmup, repetitions);
+                    if(json)
+                    {
+                        std::printf("%s  {\"algorithm\": \"%s\", \"distribution\": \"%s\", \"size\": %zu, \"repetitions\": %d, ", separator, algorithm.name, distributions[d], input.size(), repetitions);
+                        std::printf("\"min_ns\": %lld, \"median_ns\": %lld, \"p95_ns\": %lld}", result.min_ns, result.median_ns, result.p95_ns);
+                        separator = ",\n";
+                    }
+                    else
+                    {
+                        std::printf("%s,%s,%zu,%d,%lld,%lld,%lld\n", algorithm.name, distributions[d], input.size(), repetitions, result.min_ns, result.median_ns, result.p95_ns);
+                    }
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+    catch(std::exception const& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        status = 3;
+    }
+    if(json)
+    {
+        std::printf("\n]\n");
+    }
+
+    outro_sort_shutdown();
+    return status;
+}
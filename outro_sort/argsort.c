@@ -0,0 +1,324 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "outro_sort.h"
+#include "pool.h"
+
+// Minimum number of elements each thread should process.
+#define CHUNK_SIZE 65536U
+
+// Flags of the elements of a permutation.
+#define VISITED 1U
+#define LEADER 2U
+
+// Part of an array of keys packed or unpacked by one thread.
+struct PackChunk
+{
+    // Either records or pointers to them.
+    char const *records;
+    size_t record_size;
+    void const **pointers;
+
+    int64_t (*key)(void const *);
+    struct OutroSortRecord *pairs;
+    size_t *permutation;
+    size_t begin;
+    size_t end;
+};
+
+// Moves of records along the cycles of a permutation made by one thread.
+struct PermuteChunk
+{
+    char *records;
+    size_t record_size;
+    size_t const *permutation;
+    unsigned char const *flags;
+
+    // Number of moves, and the position and cycle leader of the first. If it
+    // is in the middle of a cycle, the moves before it are made by another
+    // thread.
+    size_t num_moves;
+    size_t start;
+    size_t leader;
+    int cut;
+
+    // Copies of the records at the start and the leader (made before any
+    // thread starts moving records), and space for one more record. Also a
+    // copy of the record at the start of the next chunk.
+    char *saved;
+    char const *next_saved;
+};
+
+/******************************************************************************
+ * Pair the keys of some records with their indices or addresses.
+ *
+ * @param chunk_
+ * @param unused
+ *****************************************************************************/
+static void
+pack(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct PackChunk *chunk = chunk_;
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        if(chunk->pointers != NULL)
+        {
+            chunk->pairs[i].key = chunk->key(chunk->pointers[i]);
+            chunk->pairs[i].value = (intptr_t)chunk->pointers[i];
+        }
+        else
+        {
+            chunk->pairs[i].key = chunk->key(chunk->records + i * chunk->record_size);
+            chunk->pairs[i].value = i;
+        }
+    }
+}
+
+/******************************************************************************
+ * Extract the indices or addresses from sorted pairs.
+ *
+ * @param chunk_
+ * @param unused
+ *****************************************************************************/
+static void
+unpack(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct PackChunk *chunk = chunk_;
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        if(chunk->pointers != NULL)
+        {
+            chunk->pointers[i] = (void const *)(intptr_t)chunk->pairs[i].value;
+        }
+        else
+        {
+            chunk->permutation[i] = chunk->pairs[i].value;
+        }
+    }
+}
+
+/******************************************************************************
+ * Sort the keys of records (or of the records pointed to) paired with their
+ * indices (or addresses) in a packed array, which is much less memory than
+ * moving the records themselves. The pairs are packed and unpacked by
+ * multiple threads, and sorted using outro sort.
+ *
+ * @param records Records, or `NULL` to sort pointers.
+ * @param pointers Pointers to sort, or `NULL` to sort indices.
+ * @param size Number of records or pointers.
+ * @param record_size Size of each record.
+ * @param key Function returning the key of a record.
+ * @param permutation Array to write the indices to.
+ *
+ * @return 0 if the indices or pointers were sorted, else -1, in which case
+ *     memory could not be allocated, and nothing was written.
+ *****************************************************************************/
+static int
+sort_keys(char const *records, void const **pointers, size_t size, size_t record_size, int64_t (*key)(void const *), size_t *permutation)
+{
+    struct OutroSortRecord *pairs = malloc(size * sizeof *pairs);
+    if(pairs == NULL)
+    {
+        return -1;
+    }
+    int num_chunks = outro_sort_num_chunks(size, CHUNK_SIZE);
+    struct PackChunk chunks[OUTRO_SORT_RUN_MAX];
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].records = records;
+        chunks[i].record_size = record_size;
+        chunks[i].pointers = pointers;
+        chunks[i].key = key;
+        chunks[i].pairs = pairs;
+        chunks[i].permutation = permutation;
+        chunks[i].begin = size * i / num_chunks;
+        chunks[i].end = size * (i + 1) / num_chunks;
+    }
+    outro_sort_run(pack, chunks, sizeof *chunks, num_chunks, size / num_chunks);
+    outro_sort_rec(pairs, pairs + size);
+    outro_sort_run(unpack, chunks, sizeof *chunks, num_chunks, size / num_chunks);
+    free(pairs);
+    return 0;
+}
+
+/******************************************************************************
+ * Find the order in which records would be if they were sorted by key, without
+ * moving them. The order of records with equal keys is unspecified.
+ *
+ * @param records Pointer to the first record.
+ * @param num_records Number of records.
+ * @param record_size Size of each record.
+ * @param key Function returning the key of a record. It is called once for
+ *     each record, possibly by multiple threads simultaneously.
+ * @param permutation Array to write the index of the record which would be at
+ *     each position to.
+ *
+ * @return 0 if the permutation was written, else -1, in which case memory
+ *     could not be allocated.
+ *****************************************************************************/
+int
+outro_argsort(void const *records, size_t num_records, size_t record_size, int64_t (*key)(void const *), size_t *permutation)
+{
+    return sort_keys(records, NULL, num_records, record_size, key, permutation);
+}
+
+/******************************************************************************
+ * Sort pointers to records by the keys of the records they point to.
+ *
+ * @param pointers Pointer to the first pointer.
+ * @param num_pointers Number of pointers.
+ * @param key Function returning the key of a record. It is called once for
+ *     each pointer, possibly by multiple threads simultaneously.
+ *
+ * @return 0 if the pointers were sorted, else -1, in which case memory could
+ *     not be allocated, and the pointers are unchanged.
+ *****************************************************************************/
+int
+outro_sort_indirect(void const **pointers, size_t num_pointers, int64_t (*key)(void const *))
+{
+    return sort_keys(NULL, pointers, num_pointers, 0, key, NULL);
+}
+
+/******************************************************************************
+ * Move records along the cycles of a permutation: each record receives the
+ * one its index maps to, and the last record of a cycle receives the original
+ * leader.
+ *
+ * @param chunk_
+ * @param unused
+ *****************************************************************************/
+static void
+permute(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct PermuteChunk *chunk = chunk_;
+    size_t record_size = chunk->record_size, remaining = chunk->num_moves;
+    size_t j = chunk->start, leader = chunk->leader;
+    char *scratch = chunk->saved + 2 * record_size;
+    for(int cut = chunk->cut; remaining > 0; cut = 0)
+    {
+        if(!cut)
+        {
+            memcpy(scratch, chunk->records + leader * record_size, record_size);
+        }
+        char const *last = cut ? chunk->saved + record_size : scratch;
+        for(;;)
+        {
+            size_t next = chunk->permutation[j];
+            char const *src = next == leader ? last : remaining == 1 ? chunk->next_saved : chunk->records + next * record_size;
+            memcpy(chunk->records + j * record_size, src, record_size);
+            --remaining;
+            if(next == leader || remaining == 0)
+            {
+                break;
+            }
+            j = next;
+        }
+
+        // Find the leader of the next cycle.
+        for(j = leader + 1; remaining > 0 && !(chunk->flags[j] & LEADER); ++j)
+        {
+        }
+        leader = j;
+    }
+}
+
+/******************************************************************************
+ * Rearrange records in place so that each ends up where a permutation (such as
+ * one found by `outro_argsort`) says it should. The cycles of the permutation
+ * are found by one thread, and the moves they comprise are split equally
+ * between multiple threads, so that even a single long cycle is followed in
+ * parallel. Records which cross between threads are copied beforehand.
+ *
+ * @param records Pointer to the first record.
+ * @param num_records Number of records.
+ * @param record_size Size of each record.
+ * @param permutation Index of the record which should be at each position.
+ *
+ * @return 0 if the records were rearranged, else -1, in which case the
+ *     permutation is invalid or memory could not be allocated, and the
+ *     records are unchanged.
+ *****************************************************************************/
+int
+outro_apply_permutation(void *records, size_t num_records, size_t record_size, size_t const *permutation)
+{
+    size_t num_moves = 0;
+    for(size_t i = 0; i < num_records; ++i)
+    {
+        if(permutation[i] >= num_records)
+        {
+            return -1;
+        }
+        num_moves += permutation[i] != i;
+    }
+    if(num_moves == 0)
+    {
+        return 0;
+    }
+    int num_chunks = outro_sort_num_chunks(num_records, CHUNK_SIZE);
+    unsigned char *flags = calloc(num_records, sizeof *flags);
+    char *saved = malloc(3 * num_chunks * record_size);
+    if(flags == NULL || saved == NULL)
+    {
+        free(saved);
+        free(flags);
+        return -1;
+    }
+
+    // Walk the cycles, each starting from its least index, and find where the
+    // moves of each thread begin.
+    struct PermuteChunk chunks[OUTRO_SORT_RUN_MAX];
+    int chunk = 0;
+    for(size_t i = 0, move = 0; i < num_records; ++i)
+    {
+        if(flags[i] & VISITED || permutation[i] == i)
+        {
+            continue;
+        }
+        flags[i] |= LEADER;
+        size_t j = i;
+        do
+        {
+            for(; chunk < num_chunks && move == num_moves * chunk / num_chunks; ++chunk)
+            {
+                chunks[chunk].start = j;
+                chunks[chunk].leader = i;
+                chunks[chunk].cut = j != i;
+            }
+            ++move;
+            flags[j] |= VISITED;
+            j = permutation[j];
+            if(j != i && flags[j] & VISITED)
+            {
+                free(saved);
+                free(flags);
+                return -1;
+            }
+        }
+        while(j != i);
+    }
+
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].records = records;
+        chunks[i].record_size = record_size;
+        chunks[i].permutation = permutation;
+        chunks[i].flags = flags;
+        chunks[i].num_moves = num_moves * (i + 1) / num_chunks - num_moves * i / num_chunks;
+        chunks[i].saved = saved + 3 * i * record_size;
+        chunks[i].next_saved = i + 1 < num_chunks ? saved + 3 * (i + 1) * record_size : NULL;
+        if(chunks[i].cut)
+        {
+            memcpy(chunks[i].saved, (char *)records + chunks[i].start * record_size, record_size);
+            memcpy(chunks[i].saved + record_size, (char *)records + chunks[i].leader * record_size, record_size);
+        }
+    }
+    outro_sort_run(permute, chunks, sizeof *chunks, num_chunks, num_records / num_chunks);
+    free(saved);
+    free(flags);
+    return 0;
+}
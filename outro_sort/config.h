@@ -0,0 +1,17 @@
+#ifndef TFPF_VERSATILE_SORT_OUTRO_SORT_CONFIG_H_
+#define TFPF_VERSATILE_SORT_OUTRO_SORT_CONFIG_H_
+
+#include <stddef.h>
+
+#include "outro_sort.h"
+
+// Tunable parameters shared by the sort functions of all element types, used
+// unless the calling thread is working on a sort with its own context. The
+// maximum number of threads only records the limit set using
+// `outro_sort_configure` (so that profiles can include it); the thread budget
+// itself is kept by the pool.
+extern struct OutroSortContext outro_sort_config;
+
+struct OutroSortContext const *outro_sort_settings(void);
+
+#endif  // TFPF_VERSATILE_SORT_OUTRO_SORT_CONFIG_H_
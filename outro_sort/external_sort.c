@@ -0,0 +1,733 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "outro_sort.h"
+#include "pool.h"
+
+// Sorted part of the input, stored in a temporary file.
+struct Run
+{
+    int fd;
+    size_t size;
+};
+
+// Transfer of a buffer to or from a file, which may be performed
+// asynchronously.
+struct IoRequest
+{
+    int fd;
+    void *buffer;
+    size_t size;
+    bool write;
+    size_t transferred;
+    int error;
+    bool done;
+    struct IoRequest *next;
+};
+
+#ifdef MULTITHREADED_OUTRO_SORT
+// Thread which performs the transfers which were requested, in order.
+static struct
+{
+    bool active;
+    thrd_t thr;
+    mtx_t lock;
+    cnd_t cond;
+    struct IoRequest *head;
+    struct IoRequest *tail;
+    bool stopping;
+} io;
+#endif
+
+// Buffered reader of a run. While the elements in one buffer are being
+// merged, the other is filled.
+struct RunReader
+{
+    struct Run run;
+    size_t remaining;
+    int *buffers[2];
+    size_t capacity;
+    int front;
+    int *curr;
+    int *stop;
+    struct IoRequest request;
+    bool pending;
+};
+
+// Buffered writer. While one buffer is being filled, the other is written.
+struct Writer
+{
+    int fd;
+    int *buffers[2];
+    size_t capacity;
+    int front;
+    size_t count;
+    struct IoRequest request;
+    bool pending;
+};
+
+/******************************************************************************
+ * Report an error and exit. Temporary files are unlinked as soon as they are
+ * created, so nothing needs to be cleaned up.
+ *
+ * @param what Description of the failed operation.
+ * @param error Error number.
+ *****************************************************************************/
+static void
+die(char const *what, int error)
+{
+    fprintf(stderr, "external_sort: %s: %s\n", what, strerror(error));
+    exit(EXIT_FAILURE);
+}
+
+/******************************************************************************
+ * Transfer the whole buffer of a request, stopping early only at the end of
+ * the file or on error.
+ *
+ * @param request
+ *****************************************************************************/
+static void
+io_transfer(struct IoRequest *request)
+{
+    char *buffer = request->buffer;
+    request->transferred = 0;
+    request->error = 0;
+    while(request->transferred < request->size)
+    {
+        size_t size = request->size - request->transferred;
+        ssize_t transferred = request->write ? write(request->fd, buffer + request->transferred, size)
+                                             : read(request->fd, buffer + request->transferred, size);
+        if(transferred < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(transferred < 0)
+        {
+            request->error = errno;
+            return;
+        }
+        if(transferred == 0)
+        {
+            return;
+        }
+        request->transferred += transferred;
+    }
+}
+
+#ifdef MULTITHREADED_OUTRO_SORT
+/******************************************************************************
+ * Main loop of the I/O thread.
+ *
+ * @param unused
+ *
+ * @return Ignored.
+ *****************************************************************************/
+static int
+io_worker(void *unused)
+{
+    (void)unused;
+    mtx_lock(&io.lock);
+    for(;;)
+    {
+        while(io.head == NULL && !io.stopping)
+        {
+            cnd_wait(&io.cond, &io.lock);
+        }
+        if(io.head == NULL)
+        {
+            break;
+        }
+        struct IoRequest *request = io.head;
+        io.head = request->next;
+        mtx_unlock(&io.lock);
+        io_transfer(request);
+        mtx_lock(&io.lock);
+        request->done = true;
+        cnd_broadcast(&io.cond);
+    }
+    mtx_unlock(&io.lock);
+    return EXIT_SUCCESS;
+}
+#endif
+
+/******************************************************************************
+ * Start the I/O thread. If that is not possible, transfers are performed
+ * synchronously.
+ *****************************************************************************/
+static void
+io_start(void)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    mtx_init(&io.lock, mtx_plain);
+    cnd_init(&io.cond);
+    io.head = io.tail = NULL;
+    io.stopping = false;
+    io.active = thrd_create(&io.thr, io_worker, NULL) == thrd_success;
+#endif
+}
+
+/******************************************************************************
+ * Stop the I/O thread after it completes all requested transfers.
+ *****************************************************************************/
+static void
+io_stop(void)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(io.active)
+    {
+        mtx_lock(&io.lock);
+        io.stopping = true;
+        cnd_broadcast(&io.cond);
+        mtx_unlock(&io.lock);
+        thrd_join(io.thr, NULL);
+        io.active = false;
+    }
+    cnd_destroy(&io.cond);
+    mtx_destroy(&io.lock);
+#endif
+}
+
+/******************************************************************************
+ * Request a transfer. It must be waited for before the buffer is used again.
+ *
+ * @param request Request to fill in.
+ * @param fd File descriptor.
+ * @param buffer
+ * @param size Number of bytes to transfer.
+ * @param write Whether to write to or read from the file.
+ *****************************************************************************/
+static void
+io_submit(struct IoRequest *request, int fd, void *buffer, size_t size, bool write)
+{
+    request->fd = fd;
+    request->buffer = buffer;
+    request->size = size;
+    request->write = write;
+    request->done = false;
+    request->next = NULL;
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(io.active)
+    {
+        mtx_lock(&io.lock);
+        if(io.head == NULL)
+        {
+            io.head = request;
+        }
+        else
+        {
+            io.tail->next = request;
+        }
+        io.tail = request;
+        cnd_broadcast(&io.cond);
+        mtx_unlock(&io.lock);
+        return;
+    }
+#endif
+    io_transfer(request);
+    request->done = true;
+}
+
+/******************************************************************************
+ * Wait for a transfer to complete. Exit if it failed.
+ *
+ * @param request
+ *
+ * @return Number of bytes transferred.
+ *****************************************************************************/
+static size_t
+io_wait(struct IoRequest *request)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(io.active)
+    {
+        mtx_lock(&io.lock);
+        while(!request->done)
+        {
+            cnd_wait(&io.cond, &io.lock);
+        }
+        mtx_unlock(&io.lock);
+    }
+#endif
+    if(request->error != 0)
+    {
+        die(request->write ? "write" : "read", request->error);
+    }
+    if(request->write && request->transferred < request->size)
+    {
+        die("write", ENOSPC);
+    }
+    return request->transferred;
+}
+
+/******************************************************************************
+ * Write a buffer synchronously.
+ *
+ * @param fd File descriptor.
+ * @param buffer
+ * @param size Number of bytes to write.
+ *****************************************************************************/
+static void
+write_all(int fd, void *buffer, size_t size)
+{
+    struct IoRequest request;
+    io_submit(&request, fd, buffer, size, true);
+    io_wait(&request);
+}
+
+/******************************************************************************
+ * Create an anonymous temporary file.
+ *
+ * @param directory Directory to create it in.
+ *
+ * @return File descriptor.
+ *****************************************************************************/
+static int
+temp_file(char const *directory)
+{
+    size_t size = strlen(directory) + sizeof "/outro_sort_XXXXXX";
+    char *path = malloc(size);
+    if(path == NULL)
+    {
+        die("malloc", ENOMEM);
+    }
+    snprintf(path, size, "%s/outro_sort_XXXXXX", directory);
+    int fd = mkstemp(path);
+    if(fd < 0)
+    {
+        die(path, errno);
+    }
+    unlink(path);
+    free(path);
+    return fd;
+}
+
+/******************************************************************************
+ * Request the next part of a run to be read into one of the buffers of a
+ * reader, if any of it is left.
+ *
+ * @param reader
+ * @param index Index of the buffer.
+ *****************************************************************************/
+static void
+reader_request(struct RunReader *reader, int index)
+{
+    size_t size = reader->remaining < reader->capacity ? reader->remaining : reader->capacity;
+    reader->pending = size > 0;
+    if(reader->pending)
+    {
+        io_submit(&reader->request, reader->run.fd, reader->buffers[index], size * sizeof(int), false);
+        reader->remaining -= size;
+    }
+}
+
+/******************************************************************************
+ * Switch to the buffer which was being filled, and start filling the other.
+ *
+ * @param reader
+ *
+ * @return true if there are more elements, else false.
+ *****************************************************************************/
+static bool
+reader_refill(struct RunReader *reader)
+{
+    if(!reader->pending)
+    {
+        reader->curr = reader->stop = reader->buffers[reader->front];
+        return false;
+    }
+    size_t size = io_wait(&reader->request) / sizeof(int);
+    reader->front ^= 1;
+    reader->curr = reader->buffers[reader->front];
+    reader->stop = reader->curr + size;
+    reader_request(reader, reader->front ^ 1);
+    return size > 0;
+}
+
+/******************************************************************************
+ * Prepare to read a run from the beginning.
+ *
+ * @param reader Reader to fill in.
+ * @param run
+ * @param buffers Memory for two buffers.
+ * @param capacity Number of elements in each buffer.
+ *
+ * @return true if the run is not empty, else false.
+ *****************************************************************************/
+static bool
+reader_init(struct RunReader *reader, struct Run run, int *buffers, size_t capacity)
+{
+    if(lseek(run.fd, 0, SEEK_SET) < 0)
+    {
+        die("lseek", errno);
+    }
+    reader->run = run;
+    reader->remaining = run.size;
+    reader->buffers[0] = buffers;
+    reader->buffers[1] = buffers + capacity;
+    reader->capacity = capacity;
+    reader->front = 1;
+    reader_request(reader, 0);
+    return reader_refill(reader);
+}
+
+/******************************************************************************
+ * Start writing the filled buffer of a writer, and switch to the other one.
+ *
+ * @param writer
+ *****************************************************************************/
+static void
+writer_flush(struct Writer *writer)
+{
+    if(writer->pending)
+    {
+        io_wait(&writer->request);
+    }
+    io_submit(&writer->request, writer->fd, writer->buffers[writer->front], writer->count * sizeof(int), true);
+    writer->pending = true;
+    writer->front ^= 1;
+    writer->count = 0;
+}
+
+/******************************************************************************
+ * Append an element to the output.
+ *
+ * @param writer
+ * @param val
+ *****************************************************************************/
+static inline void
+writer_put(struct Writer *writer, int val)
+{
+    writer->buffers[writer->front][writer->count++] = val;
+    if(writer->count == writer->capacity)
+    {
+        writer_flush(writer);
+    }
+}
+
+/******************************************************************************
+ * Write whatever is left in the buffers of a writer.
+ *
+ * @param writer
+ *****************************************************************************/
+static void
+writer_finish(struct Writer *writer)
+{
+    if(writer->count > 0)
+    {
+        writer_flush(writer);
+    }
+    if(writer->pending)
+    {
+        io_wait(&writer->request);
+    }
+}
+
+/******************************************************************************
+ * Check whether the current element of one run should be output before that
+ * of another. Exhausted runs lose against all others.
+ *
+ * @param readers
+ * @param a Index of the first run.
+ * @param b Index of the second run.
+ *
+ * @return true if the first run wins, else false.
+ *****************************************************************************/
+static inline bool
+beats(struct RunReader const *readers, int a, int b)
+{
+    if(readers[a].curr == readers[a].stop)
+    {
+        return false;
+    }
+    if(readers[b].curr == readers[b].stop)
+    {
+        return true;
+    }
+    return *readers[a].curr < *readers[b].curr || (*readers[a].curr == *readers[b].curr && a < b);
+}
+
+/******************************************************************************
+ * Update a loser tree after the current element of a run has changed. The
+ * loser of the match at each internal node is stored in it, and the overall
+ * winner in the root. While the tree is being built, empty nodes are marked
+ * by negative indices.
+ *
+ * @param tree Loser tree. Node `i` has children `2 * i` and `2 * i + 1`,
+ *     leaves are numbered from the number of runs, and node 0 holds the
+ *     winner.
+ * @param readers
+ * @param num_runs
+ * @param leaf Index of the run.
+ *****************************************************************************/
+static void
+replay(int *tree, struct RunReader const *readers, int num_runs, int leaf)
+{
+    int winner = leaf;
+    for(int node = (leaf + num_runs) / 2; node > 0; node /= 2)
+    {
+        if(tree[node] < 0)
+        {
+            tree[node] = winner;
+            return;
+        }
+        if(beats(readers, tree[node], winner))
+        {
+            int tmp = tree[node];
+            tree[node] = winner;
+            winner = tmp;
+        }
+    }
+    tree[0] = winner;
+}
+
+/******************************************************************************
+ * Merge runs using a loser tree. Each run is read into two buffers, one of
+ * which is filled asynchronously while the other is merged. The output is
+ * written the same way.
+ *
+ * @param runs
+ * @param num_runs
+ * @param fd File descriptor of the output.
+ * @param memory Memory for the buffers.
+ * @param memory_size Number of elements which fit in the memory.
+ *
+ * @return Number of elements merged.
+ *****************************************************************************/
+static size_t
+merge(struct Run const *runs, int num_runs, int fd, int *memory, size_t memory_size)
+{
+    size_t capacity = memory_size / (2 * num_runs + 2);
+    struct RunReader *readers = malloc(num_runs * sizeof *readers);
+    int *tree = malloc(num_runs * sizeof *tree);
+    if(readers == NULL || tree == NULL)
+    {
+        die("malloc", ENOMEM);
+    }
+    for(int i = 0; i < num_runs; ++i)
+    {
+        reader_init(readers + i, runs[i], memory + 2 * capacity * i, capacity);
+        tree[i] = -1;
+    }
+    for(int i = 0; i < num_runs; ++i)
+    {
+        replay(tree, readers, num_runs, i);
+    }
+
+    struct Writer writer = {.fd = fd, .capacity = capacity};
+    writer.buffers[0] = memory + 2 * capacity * num_runs;
+    writer.buffers[1] = writer.buffers[0] + capacity;
+    size_t size = 0;
+    for(int winner = tree[0]; readers[winner].curr < readers[winner].stop; winner = tree[0])
+    {
+        writer_put(&writer, *readers[winner].curr++);
+        ++size;
+        if(readers[winner].curr == readers[winner].stop)
+        {
+            reader_refill(readers + winner);
+        }
+        replay(tree, readers, num_runs, winner);
+    }
+    writer_finish(&writer);
+    free(tree);
+    free(readers);
+    return size;
+}
+
+/******************************************************************************
+ * Print the usage.
+ *
+ * @param name Name of the program.
+ *****************************************************************************/
+static void
+usage(char const *name)
+{
+    fprintf(stderr, "usage: %s [-m memory] [-k fan_in] [-t directory] [-M] input output\n", name);
+    fprintf(stderr, "Sort a binary file of native 32-bit integers which need not fit in memory.\n");
+    fprintf(stderr, "  -m memory     memory to use, in MiB (default 1024); radix sort, which would\n");
+    fprintf(stderr, "                need as much again, is disabled to stay within it\n");
+    fprintf(stderr, "  -k fan_in     maximum number of runs merged at once (default 64)\n");
+    fprintf(stderr, "  -t directory  directory for temporary files (default $TMPDIR or /tmp)\n");
+    fprintf(stderr, "  -M            read the input through a memory mapping\n");
+}
+
+/******************************************************************************
+ * Main function. The input is read in chunks which fit in memory, each of
+ * which is sorted using outro sort and written to a temporary file. Then
+ * groups of these runs are merged until all of them can be merged into the
+ * output.
+ *****************************************************************************/
+int
+main(int const argc, char *argv[])
+{
+    size_t memory_limit = 1024;
+    int fan_in = 64;
+    char const *directory = getenv("TMPDIR");
+    bool use_mmap = false;
+    for(int opt; (opt = getopt(argc, argv, "m:k:t:M")) != -1;)
+    {
+        switch(opt)
+        {
+            case 'm':
+                memory_limit = strtoul(optarg, NULL, 10);
+                break;
+            case 'k':
+                fan_in = atoi(optarg);
+                break;
+            case 't':
+                directory = optarg;
+                break;
+            case 'M':
+                use_mmap = true;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(argc - optind != 2 || memory_limit == 0 || fan_in < 2)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if(directory == NULL || *directory == '\0')
+    {
+        directory = "/tmp";
+    }
+
+    int in_fd = open(argv[optind], O_RDONLY);
+    if(in_fd < 0)
+    {
+        die(argv[optind], errno);
+    }
+    struct stat st;
+    if(fstat(in_fd, &st) < 0)
+    {
+        die(argv[optind], errno);
+    }
+    size_t size = st.st_size / sizeof(int);
+    int const *mapping = NULL;
+    if(use_mmap && size > 0)
+    {
+        mapping = mmap(NULL, size * sizeof(int), PROT_READ, MAP_PRIVATE, in_fd, 0);
+        if(mapping == MAP_FAILED)
+        {
+            die("mmap", errno);
+        }
+        posix_madvise((void *)mapping, size * sizeof(int), POSIX_MADV_SEQUENTIAL);
+    }
+    int out_fd = open(argv[optind + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(out_fd < 0)
+    {
+        die(argv[optind + 1], errno);
+    }
+
+    // Each merge needs two buffers per run and two for the output.
+    size_t memory_size = (memory_limit << 20) / sizeof(int);
+    if(memory_size < 2 * (size_t)fan_in + 2)
+    {
+        memory_size = 2 * (size_t)fan_in + 2;
+    }
+    int *memory = malloc(memory_size * sizeof *memory);
+    if(memory == NULL)
+    {
+        die("malloc", ENOMEM);
+    }
+    io_start();
+
+    // Radix sort would allocate a buffer as large as each chunk.
+    outro_sort_configure_radix(0);
+
+    // Form the runs. If the input fits in memory, there is only one, which is
+    // written to the output directly.
+    struct Run *runs = NULL;
+    int num_runs = 0, max_runs = 0;
+    for(size_t begin = 0; begin < size || size == 0; begin += memory_size)
+    {
+        size_t chunk_size = size - begin < memory_size ? size - begin : memory_size;
+        if(mapping != NULL)
+        {
+            memcpy(memory, mapping + begin, chunk_size * sizeof *memory);
+        }
+        else
+        {
+            struct IoRequest request;
+            io_submit(&request, in_fd, memory, chunk_size * sizeof *memory, false);
+            chunk_size = io_wait(&request) / sizeof *memory;
+        }
+        outro_sort(memory, memory + chunk_size);
+        if(chunk_size == size)
+        {
+            write_all(out_fd, memory, chunk_size * sizeof *memory);
+            break;
+        }
+        if(num_runs == max_runs)
+        {
+            max_runs = max_runs > 0 ? 2 * max_runs : 16;
+            runs = realloc(runs, max_runs * sizeof *runs);
+            if(runs == NULL)
+            {
+                die("realloc", ENOMEM);
+            }
+        }
+        runs[num_runs].fd = temp_file(directory);
+        runs[num_runs].size = chunk_size;
+        write_all(runs[num_runs].fd, memory, chunk_size * sizeof *memory);
+        ++num_runs;
+    }
+
+    // Merge the oldest runs until few enough are left. Every run takes part in
+    // the same number of merges (give or take one).
+    int first = 0;
+    while(num_runs - first > fan_in)
+    {
+        struct Run merged = {.fd = temp_file(directory)};
+        merged.size = merge(runs + first, fan_in, merged.fd, memory, memory_size);
+        for(int i = first; i < first + fan_in; ++i)
+        {
+            close(runs[i].fd);
+        }
+        first += fan_in;
+        if(num_runs == max_runs)
+        {
+            max_runs *= 2;
+            runs = realloc(runs, max_runs * sizeof *runs);
+            if(runs == NULL)
+            {
+                die("realloc", ENOMEM);
+            }
+        }
+        runs[num_runs++] = merged;
+    }
+    if(num_runs > first)
+    {
+        merge(runs + first, num_runs - first, out_fd, memory, memory_size);
+    }
+    for(int i = first; i < num_runs; ++i)
+    {
+        close(runs[i].fd);
+    }
+
+    io_stop();
+    free(runs);
+    free(memory);
+    if(mapping != NULL)
+    {
+        munmap((void *)mapping, size * sizeof(int));
+    }
+    if(close(out_fd) < 0)
+    {
+        die(argv[optind + 1], errno);
+    }
+    close(in_fd);
+    return EXIT_SUCCESS;
+}
@@ -1,211 +1,121 @@
+#include <limits.h>
 #include <stddef.h>
-#include <stdlib.h>
+#include <stdint.h>
 
+#include "config.h"
 #include "outro_sort.h"
+#include "simd.h"
 
-#if !defined __STDC_NO_THREADS__ && !defined __STDC_NO_ATOMICS__
-#define MULTITHREADED_OUTRO_SORT
-#include <stdatomic.h>
-#include <threads.h>
-static atomic_int available_threads = 32;
-static size_t multithreading_threshold = 32768U;
-#endif
-
-struct Interval
-{
-    int *begin;
-    int *end;
+struct OutroSortContext outro_sort_config = {
+    .max_threads = 32,
+    .multithreading_threshold = 32768U,
+    .radix_threshold = 65536U,
+    .partition = OUTRO_SORT_PARTITION_AUTO,
+    .leaf_size = 16U,
+    .mode = OUTRO_SORT_MODE_PARTITION,
+    .parallel_partition_threshold = 1048576U,
 };
 
 /******************************************************************************
- * Configure outro sort.
+ * Configure the automatic selection of radix sort.
  *
- * @param available_threads_ Maximum number of simultaneously active threads.
- *     This need not be equal to the number of logical processors; typically,
- *     using a much larger number will significantly improve performance. If
- *     multithreading is not supported, this argument is ignored.
- * @param multithreading_threshold_ Minimum size of a subarray for which
- *     multithreading should be used. If multithreading is not supported, this
- *     argument is ignored.
+ * @param radix_threshold Minimum size of an array for which radix sort should
+ *     be used instead of partitioning, if the keys are integers. Use 0 to
+ *     disable radix sort.
  *****************************************************************************/
 void
-outro_sort_configure(int available_threads_, size_t multithreading_threshold_)
+outro_sort_configure_radix(size_t radix_threshold)
 {
-#ifdef MULTITHREADED_OUTRO_SORT
-    available_threads = available_threads_;
-    multithreading_threshold = multithreading_threshold_;
-#endif
+    outro_sort_config.radix_threshold = radix_threshold;
 }
 
 /******************************************************************************
- * Exchange the integers stored at the given addresses.
+ * Select the partitioning method. If a vectorised kernel was forced when
+ * building, it is used regardless of this setting.
  *
- * @param a
- * @param b
+ * @param partition
  *****************************************************************************/
-static void
-swap(int *a, int *b)
+void
+outro_sort_configure_partition(enum OutroSortPartition partition)
 {
-    int tmp = *a;
-    *a = *b;
-    *b = tmp;
+    outro_sort_config.partition = partition;
 }
 
 /******************************************************************************
- * Sort the elements of a subarray using insertion sort.
+ * Select the algorithm used for large arrays. Sample sort moves each element
+ * between threads only once, which reduces traffic between processors on
+ * machines with multiple sockets, but needs memory for a copy of the array.
  *
- * @param begin Pointer to the first element.
- * @param end Pointer to one past the last element.
+ * @param mode
  *****************************************************************************/
 void
-insertion_sort(int *begin, int *end)
+outro_sort_configure_mode(enum OutroSortMode mode)
 {
-    if(begin + 1 >= end)
-    {
-        return;
-    }
-    for(int *curr = begin + 1; curr < end; ++curr)
-    {
-        for(int *gap = curr; gap > begin; --gap)
-        {
-            if(*(gap - 1) > *gap)
-            {
-                swap(gap - 1, gap);
-            }
-        }
-    }
+    outro_sort_config.mode = mode;
 }
 
 /******************************************************************************
- * Pick a pivot. Try to avoid the least and greatest numbers.
- *
- * @param begin Pointer to the first element.
- * @param end Pointer to one past the last element.
+ * Configure parallel partitioning. Subarrays at least this large are split
+ * into chunks, which are partitioned by different threads, so that the first
+ * few partitioning steps are not limited to one thread.
  *
- * @return Pivot.
+ * @param parallel_partition_threshold Minimum size of a subarray which should
+ *     be partitioned by multiple threads. Use 0 to disable parallel
+ *     partitioning.
  *****************************************************************************/
-static int
-outro_sort_pivot(int const *begin, int const *end)
+void
+outro_sort_configure_parallel_partition(size_t parallel_partition_threshold)
 {
-    int const *middle = (end - 1 - begin) / 2 + begin;
-    int val[] = {*begin, *middle, *(end - 1)};
-    if(val[0] > val[1])
-    {
-        swap(val, val + 1);
-    }
-    if(val[0] > val[2])
-    {
-        swap(val, val + 2);
-    }
-    return val[1] < val[2] ? val[1] : val[2];
+    outro_sort_config.parallel_partition_threshold = parallel_partition_threshold;
 }
 
 /******************************************************************************
- * Apply Hoare's partioning scheme to a subarray: group all elements less than
- * the pivot (and possibly some elements equal to it) on one side of the pivot.
- *
- * @param begin Pointer to the first element.
- * @param end Pointer to one past the last element.
+ * Configure the size of the subarrays at which partitioning stops.
  *
- * @return Partition pointer. All elements at lower addresses will be less than
- *     or equal to the pivot.
+ * @param leaf_size Maximum size of a subarray which should be sorted without
+ *     partitioning. Up to 16 elements are sorted using a sorting network, more
+ *     using insertion sort. Values less than 3 are treated as 3.
  *****************************************************************************/
-static int *
-outro_sort_partition(int *begin, int *end)
+void
+outro_sort_configure_leaf(size_t leaf_size)
 {
-    int pivot_val = outro_sort_pivot(begin, end);
-    for(;; ++begin, --end)
-    {
-        while(*begin < pivot_val)
-        {
-            ++begin;
-        }
-        while(*(end - 1) > pivot_val)
-        {
-            --end;
-        }
-        if(begin + 1 >= end)
-        {
-            return end;
-        }
-        swap(begin, end - 1);
-    }
+    outro_sort_config.leaf_size = leaf_size < 3 ? 3 : leaf_size;
 }
 
-#ifdef MULTITHREADED_OUTRO_SORT
-/******************************************************************************
- * Helper function to perform outro sort.
- *
- * @param interval_ Sort range.
- *
- * @return Ignored.
- *****************************************************************************/
-static int
-outro_sort_exec(void *interval_)
-{
-    struct Interval *interval = interval_;
-    outro_sort(interval->begin, interval->end);
-    thrd_exit(EXIT_SUCCESS);
-}
-#endif
+#define OUTRO_SORT_TYPE int
+#define OUTRO_SORT_SUFFIX
+#define OUTRO_SORT_RADIX_TYPE unsigned
+#define OUTRO_SORT_RADIX_KEY(key) ((unsigned)(key) ^ ~(UINT_MAX >> 1))
+#define OUTRO_SORT_PARTITION_KERNEL outro_sort_partition_simd
+#define OUTRO_SORT_NETWORK_KERNEL outro_sort_network_simd
+#include "outro_sort_generic.h"
 
-/******************************************************************************
- * Helper function to perform outro sort in a separate thread (if possible).
- *
- * @param begin Pointer to the first element.
- * @param end Pointer to one past the last element.
- * @param worker Thread to start.
- *
- * @return 0 if the thread was started, else -1.
- *****************************************************************************/
-static int
-outro_sort_dispatch(int *begin, int *end, void *thr)
-{
-#ifdef MULTITHREADED_OUTRO_SORT
-    if(begin + multithreading_threshold <= end && available_threads > 1)
-    {
-        if(thrd_create(thr, outro_sort_exec, &(struct Interval){.begin=begin, .end=end}) == thrd_success)
-        {
-            --available_threads;
-            return 0;
-        }
-    }
-#endif
-    outro_sort(begin, end);
-    return -1;
-}
+#define OUTRO_SORT_TYPE int64_t
+#define OUTRO_SORT_SUFFIX _i64
+#define OUTRO_SORT_RADIX_TYPE uint64_t
+#define OUTRO_SORT_RADIX_KEY(key) ((uint64_t)(key) ^ UINT64_C(1) << 63)
+#include "outro_sort_generic.h"
 
-/******************************************************************************
- * Sort the elements of a subarray using outro sort. This is a hybrid algorithm
- * which executes insertion sort on small subarrays and quick sort on large
- * subarrays.
- *
- * @param begin Pointer to the first element.
- * @param end Pointer to one past the last element.
- *****************************************************************************/
-void
-outro_sort(int *begin, int *end)
-{
-    if(begin + 16 >= end)
-    {
-        insertion_sort(begin, end);
-        return;
-    }
-    int *ploc = outro_sort_partition(begin, end);
+#define OUTRO_SORT_TYPE uint32_t
+#define OUTRO_SORT_SUFFIX _u32
+#define OUTRO_SORT_RADIX_TYPE uint32_t
+#define OUTRO_SORT_RADIX_KEY(key) (key)
+#include "outro_sort_generic.h"
 
-#ifdef MULTITHREADED_OUTRO_SORT
-    thrd_t worker;
-#else
-    int worker;
-#endif
-    int wstatus = outro_sort_dispatch(begin, ploc, &worker);
-    outro_sort(ploc, end);
+#define OUTRO_SORT_TYPE uint64_t
+#define OUTRO_SORT_SUFFIX _u64
+#define OUTRO_SORT_RADIX_TYPE uint64_t
+#define OUTRO_SORT_RADIX_KEY(key) (key)
+#include "outro_sort_generic.h"
 
-#ifdef MULTITHREADED_OUTRO_SORT
-    if(wstatus == 0)
-    {
-        thrd_join(worker, NULL);
-        ++available_threads;
-    }
-#endif
-}
+#define OUTRO_SORT_TYPE double
+#define OUTRO_SORT_SUFFIX _f64
+#include "outro_sort_generic.h"
+
+#define OUTRO_SORT_TYPE struct OutroSortRecord
+#define OUTRO_SORT_SUFFIX _rec
+#define OUTRO_SORT_KEY_TYPE int64_t
+#define OUTRO_SORT_KEY_OFFSET offsetof(struct OutroSortRecord, key)
+#define OUTRO_SORT_RADIX_TYPE uint64_t
+#define OUTRO_SORT_RADIX_KEY(key) ((uint64_t)(key) ^ UINT64_C(1) << 63)
+#include "outro_sort_generic.h"
@@ -2,9 +2,215 @@
 #define TFPF_VERSATILE_SORT_OUTRO_SORT_OUTRO_SORT_H_
 
 #include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Key/payload pair, sorted by key.
+struct OutroSortRecord
+{
+    int64_t key;
+    int64_t value;
+};
+
+// Partitioning methods.
+enum OutroSortPartition
+{
+    // Vectorised kernel (for `int` arrays on x86 processors which support
+    // AVX2 or AVX-512), else block partitioning.
+    OUTRO_SORT_PARTITION_AUTO,
+
+    // Hoare's partitioning scheme.
+    OUTRO_SORT_PARTITION_HOARE,
+
+    // Branchless block partitioning.
+    OUTRO_SORT_PARTITION_BLOCK,
+
+    // Vectorised kernels. For other element types, or if the processor does
+    // not support the required instructions, block partitioning is used.
+    OUTRO_SORT_PARTITION_AVX2,
+    OUTRO_SORT_PARTITION_AVX512,
+};
+
+// Algorithms used by `outro_sort` for large arrays.
+enum OutroSortMode
+{
+    // Recursive partitioning.
+    OUTRO_SORT_MODE_PARTITION,
+
+    // Sample sort: distribute the elements into one bucket per thread in a
+    // single pass, and sort the buckets independently.
+    OUTRO_SORT_MODE_SAMPLE,
+};
+
+// Phases of outro sort distinguished by the statistics.
+enum OutroSortPhase
+{
+    // Partitioning a subarray (by one or more threads).
+    OUTRO_SORT_PHASE_PARTITION,
+
+    // Sorting a small subarray using a sorting network or insertion sort.
+    OUTRO_SORT_PHASE_LEAF,
+
+    // Handing a subarray to another thread, and waiting for it to be sorted.
+    OUTRO_SORT_PHASE_DISPATCH,
+
+    OUTRO_SORT_PHASE_COUNT,
+};
+
+// Hardware performance counters read in each phase.
+enum OutroSortCounter
+{
+    OUTRO_SORT_COUNTER_CYCLES,
+    OUTRO_SORT_COUNTER_INSTRUCTIONS,
+    OUTRO_SORT_COUNTER_BRANCH_MISSES,
+    OUTRO_SORT_COUNTER_LLC_MISSES,
+    OUTRO_SORT_COUNTER_COUNT,
+};
+
+// Statistics accumulated by all sort functions since they were last reset.
+// They are only collected if the library is built with `OUTRO_SORT_STATS`.
+struct OutroSortStats
+{
+    // Outcomes of attempts to sort a subarray in another thread: queued for
+    // the thread pool, passed to a new thread, or sorted by the calling
+    // thread after all.
+    uint64_t queued;
+    uint64_t spawned;
+    uint64_t inlined;
+
+    // Maximum number of nested calls of the recursive sort function in any
+    // thread.
+    uint64_t max_depth;
+
+    // Hardware performance counters (user space only) of the threads which
+    // sorted, by phase. Time spent in a phase nested in another (such as
+    // partitioning a subarray while waiting for a dispatched one) is only
+    // attributed to the inner phase.
+    uint64_t counters[OUTRO_SORT_PHASE_COUNT][OUTRO_SORT_COUNTER_COUNT];
+
+    // Bit mask of the counters which could be read (on Linux, subject to
+    // `perf_event_paranoid`).
+    unsigned available_counters;
+};
+
+// Settings of sorts which use a context instead of the global configuration,
+// and statistics accumulated by them.
+struct OutroSortContext
+{
+    // Maximum number of threads which may sort simultaneously (including the
+    // calling thread). Threads started are also subject to the limit set
+    // using `outro_sort_configure`.
+    int max_threads;
+
+    // Minimum size of a subarray for which multithreading is used.
+    size_t multithreading_threshold;
+
+    // Minimum size of an array for which radix sort is used instead of
+    // partitioning, if the key type supports it. 0 if radix sort should never
+    // be used.
+    size_t radix_threshold;
+
+    enum OutroSortPartition partition;
+
+    enum OutroSortMode mode;
+
+    // Minimum size of a subarray which is partitioned by multiple threads. 0
+    // if partitioning should always be done by one thread.
+    size_t parallel_partition_threshold;
+
+    // Maximum size of a subarray which is sorted without partitioning. At
+    // most 16 elements are sorted using a sorting network, more using
+    // insertion sort.
+    size_t leaf_size;
+
+    // Memory (suitably aligned for any type) which radix sort, sample sort
+    // and stable sort use instead of allocating a buffer, if it is large
+    // enough. Only one sort at a time may use a context which has it.
+    void *scratch;
+    size_t scratch_size;
+
+    // Numbers of subarrays queued, passed to new threads and sorted inline
+    // by sorts which used this context. (Recursion depths and hardware
+    // counters are only collected globally.)
+    struct OutroSortStats stats;
+};
+
+// Handle to an asynchronous sort.
+struct OutroSortJob;
+
+// Declare the functions generated by `outro_sort_generic.h` for an element
+// type, and define the state they use to select the least elements of a
+// stream: a buffer holding the candidates (the least `k` elements seen so far
+// and those which arrived since the buffer was last pruned).
+#define OUTRO_SORT_DECLARE(type, suffix)  \
+    struct OutroSortTopK##suffix  \
+    {  \
+        type *buffer;  \
+        size_t k;  \
+        size_t size;  \
+        size_t capacity;  \
+        int pruned;  \
+    };  \
+    void insertion_sort##suffix(type *, type *);  \
+    int sample_sort##suffix(type *, type *);  \
+    int stable_sort##suffix(type *, type *);  \
+    void outro_sort##suffix(type *, type *);  \
+    void outro_sort_ctx##suffix(struct OutroSortContext *, type *, type *);  \
+    int outro_sort_submit##suffix(type *, type *, struct OutroSortJob **);  \
+    void outro_partial_sort##suffix(type *, type *, type *);  \
+    void outro_nth_element##suffix(type *, type *, type *);  \
+    int outro_top_k_init##suffix(struct OutroSortTopK##suffix *, size_t);  \
+    void outro_top_k_push##suffix(struct OutroSortTopK##suffix *, type const *, type const *);  \
+    size_t outro_top_k_result##suffix(struct OutroSortTopK##suffix *);  \
+    void outro_top_k_destroy##suffix(struct OutroSortTopK##suffix *);
+
+// Declare the additional functions generated for an element type with
+// integer keys.
+#define OUTRO_SORT_DECLARE_RADIX(type, suffix)  \
+    int radix_sort##suffix(type *, type *);
+
+OUTRO_SORT_DECLARE(int, )
+OUTRO_SORT_DECLARE(int64_t, _i64)
+OUTRO_SORT_DECLARE(uint32_t, _u32)
+OUTRO_SORT_DECLARE(uint64_t, _u64)
+OUTRO_SORT_DECLARE(double, _f64)
+OUTRO_SORT_DECLARE(struct OutroSortRecord, _rec)
+OUTRO_SORT_DECLARE_RADIX(int, )
+OUTRO_SORT_DECLARE_RADIX(int64_t, _i64)
+OUTRO_SORT_DECLARE_RADIX(uint32_t, _u32)
+OUTRO_SORT_DECLARE_RADIX(uint64_t, _u64)
+OUTRO_SORT_DECLARE_RADIX(struct OutroSortRecord, _rec)
 
-void insertion_sort(int *, int *);
-void outro_sort(int *, int *);
 void outro_sort_configure(int, size_t);
+void outro_sort_configure_radix(size_t);
+void outro_sort_configure_partition(enum OutroSortPartition);
+void outro_sort_configure_leaf(size_t);
+void outro_sort_configure_parallel_partition(size_t);
+void outro_sort_configure_mode(enum OutroSortMode);
+void outro_sort_context_init(struct OutroSortContext *);
+int outro_sort_tune(struct OutroSortContext *, size_t, uint64_t);
+int outro_sort_profile_save(struct OutroSortContext const *, char const *);
+int outro_sort_profile_load(struct OutroSortContext *, char const *);
+int outro_sort_configure_profile(char const *);
+int outro_sort_init(int);
+void outro_sort_shutdown(void);
+int outro_sort_stats(struct OutroSortStats *);
+void outro_sort_stats_reset(void);
+int outro_sort_poll(struct OutroSortJob *);
+void outro_sort_cancel(struct OutroSortJob *);
+int outro_sort_wait(struct OutroSortJob *);
+int outro_argsort(void const *, size_t, size_t, int64_t (*)(void const *), size_t *);
+int outro_sort_indirect(void const **, size_t, int64_t (*)(void const *));
+int outro_apply_permutation(void *, size_t, size_t, size_t const *);
+int outro_sort_strings(char const **, size_t);
+int outro_argsort_strings(char const *const *, size_t, size_t *);
+int outro_argsort_bytes(void const *const *, size_t const *, size_t, size_t *);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif  // TFPF_VERSATILE_SORT_OUTRO_SORT_OUTRO_SORT_H_
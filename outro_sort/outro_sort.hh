@@ -0,0 +1,413 @@
+#ifndef TFPF_VERSATILE_SORT_OUTRO_SORT_OUTRO_SORT_HH_
+#define TFPF_VERSATILE_SORT_OUTRO_SORT_OUTRO_SORT_HH_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace outro
+{
+///////////////////////////////////////////////////////////////////////////////
+/// Tuning parameters of outro sort for an element type. Specialise this to
+/// change them for a particular type.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+struct sort_traits
+{
+    // Subarrays containing these many or fewer elements are sorted using
+    // insertion sort. Must be at least 3.
+    static constexpr std::ptrdiff_t leaf_size = 16;
+};
+
+namespace detail
+{
+///////////////////////////////////////////////////////////////////////////////
+/// Maximum number of simultaneously active threads.
+///////////////////////////////////////////////////////////////////////////////
+inline std::atomic<int>& available_threads()
+{
+    static std::atomic<int> available_threads_(32);
+    return available_threads_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Minimum size of a subarray for which multithreading should be used.
+///////////////////////////////////////////////////////////////////////////////
+inline std::atomic<std::ptrdiff_t>& multithreading_threshold()
+{
+    static std::atomic<std::ptrdiff_t> multithreading_threshold_(32768);
+    return multithreading_threshold_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Sort the elements of a range using insertion sort.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt, typename Compare>
+void insertion_sort(RandomIt first, RandomIt last, Compare& comp)
+{
+    if(first == last)
+    {
+        return;
+    }
+    for(RandomIt curr = first + 1; curr != last; ++curr)
+    {
+        auto val = std::move(*curr);
+        RandomIt gap = curr;
+        for(; gap != first && comp(val, *(gap - 1)); --gap)
+        {
+            *gap = std::move(*(gap - 1));
+        }
+        *gap = std::move(val);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Move the median of the three given elements to the first position. Try to
+/// avoid the least and greatest elements.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt, typename Compare>
+void move_pivot_to_first(RandomIt result, RandomIt a, RandomIt b, RandomIt c, Compare& comp)
+{
+    if(comp(*a, *b))
+    {
+        if(comp(*b, *c))
+        {
+            std::iter_swap(result, b);
+        }
+        else if(comp(*a, *c))
+        {
+            std::iter_swap(result, c);
+        }
+        else
+        {
+            std::iter_swap(result, a);
+        }
+    }
+    else if(comp(*a, *c))
+    {
+        std::iter_swap(result, a);
+    }
+    else if(comp(*b, *c))
+    {
+        std::iter_swap(result, c);
+    }
+    else
+    {
+        std::iter_swap(result, b);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Apply Hoare's partitioning scheme to a range. The pivot is moved to the
+/// first position, from where it acts as a sentinel along with the other two
+/// candidates.
+///
+/// Returns the partition iterator. No element before it compares greater than
+/// any element at or after it.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt, typename Compare>
+RandomIt partition(RandomIt first, RandomIt last, Compare& comp)
+{
+    RandomIt middle = first + (last - first) / 2;
+    detail::move_pivot_to_first(first, first + 1, middle, last - 1, comp);
+    RandomIt pivot = first;
+    for(++first;; ++first)
+    {
+        while(comp(*first, *pivot))
+        {
+            ++first;
+        }
+        --last;
+        while(comp(*pivot, *last))
+        {
+            --last;
+        }
+        if(!(first < last))
+        {
+            return first;
+        }
+        std::iter_swap(first, last);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// A range handed to a worker thread. The thread which dispatched it waits
+/// for it to be done before it goes out of scope.
+///////////////////////////////////////////////////////////////////////////////
+struct task
+{
+    std::function<void()> func;
+    std::exception_ptr exc;
+    bool done = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Worker threads which stay alive between sorts, so that dispatching a range
+/// does not cost a thread creation. A worker is only created when a range is
+/// dispatched while all of them are busy; since every range dispatched holds
+/// a thread from `available_threads`, there are never more workers than that
+/// allows at its peak. The workers are joined when the program exits.
+///////////////////////////////////////////////////////////////////////////////
+class worker_pool
+{
+public:
+    static worker_pool& instance()
+    {
+        static worker_pool pool_;
+        return pool_;
+    }
+
+    ~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for(std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    /// Hand a task to an idle worker, creating one if there is none. Returns
+    /// `false` if no worker could be created.
+    bool submit(task& t)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(idle_ == 0)
+        {
+            try
+            {
+                workers_.emplace_back(&worker_pool::run, this);
+            }
+            catch(std::system_error const&)
+            {
+                return false;
+            }
+            ++idle_;
+        }
+        --idle_;
+        tasks_.push_back(&t);
+        wake_.notify_one();
+        return true;
+    }
+
+    /// Wait for a submitted task to be done.
+    void wait(task& t)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [&t]() { return t.done; });
+    }
+
+private:
+    worker_pool() = default;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for(;;)
+        {
+            wake_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if(tasks_.empty())
+            {
+                return;
+            }
+            task* t = tasks_.front();
+            tasks_.pop_front();
+            lock.unlock();
+            try
+            {
+                t->func();
+            }
+            catch(...)
+            {
+                t->exc = std::current_exception();
+            }
+            lock.lock();
+            t->done = true;
+            ++idle_;
+            finished_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable finished_;
+    std::deque<task*> tasks_;
+    std::vector<std::thread> workers_;
+    int idle_ = 0;
+    bool stopping_ = false;
+};
+
+template <typename RandomIt, typename Compare>
+void sort(RandomIt first, RandomIt last, Compare& comp, int depth);
+
+///////////////////////////////////////////////////////////////////////////////
+/// Sort the first range in a worker thread (if possible) while the current
+/// thread sorts the second range. Returns `true` after both are sorted, or
+/// `false` without sorting either if no worker was available.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt, typename Compare>
+bool dispatch(RandomIt small_first, RandomIt small_last, RandomIt first, RandomIt last, Compare& comp, int depth)
+{
+    std::atomic<int>& available = available_threads();
+    if(small_last - small_first < multithreading_threshold().load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    int expected = available.load(std::memory_order_relaxed);
+    while(expected > 1 && !available.compare_exchange_weak(expected, expected - 1))
+    {
+    }
+    if(expected <= 1)
+    {
+        return false;
+    }
+
+    // The comparator is copied so that the threads do not share it.
+    Compare comp_copy(comp);
+    task small;
+    worker_pool& pool = worker_pool::instance();
+    try
+    {
+        small.func = [small_first, small_last, depth, &comp_copy]()
+        {
+            detail::sort(small_first, small_last, comp_copy, depth);
+        };
+    }
+    catch(...)
+    {
+        available.fetch_add(1);
+        throw;
+    }
+    if(!pool.submit(small))
+    {
+        available.fetch_add(1);
+        return false;
+    }
+    try
+    {
+        detail::sort(first, last, comp, depth);
+    }
+    catch(...)
+    {
+        pool.wait(small);
+        available.fetch_add(1);
+        throw;
+    }
+    pool.wait(small);
+    available.fetch_add(1);
+    if(small.exc)
+    {
+        std::rethrow_exception(small.exc);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Number of times a range may be partitioned before switching to heap sort:
+/// twice the binary logarithm of its size.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt>
+int depth_limit(RandomIt first, RandomIt last)
+{
+    int depth = 0;
+    for(auto size = last - first; size > 1; size >>= 1)
+    {
+        depth += 2;
+    }
+    return depth;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Sort a range using outro sort. After partitioning, the smaller part is
+/// sorted recursively (in another thread, if possible), and the larger one by
+/// the same call, so that the recursion is at most logarithmically deep. The
+/// depth budget is shared by both parts; when it runs out, the range is
+/// sorted using heap sort, so the running time is O(n log n) in the worst
+/// case.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt, typename Compare>
+void sort(RandomIt first, RandomIt last, Compare& comp, int depth)
+{
+    using Type = typename std::iterator_traits<RandomIt>::value_type;
+    while(last - first > sort_traits<Type>::leaf_size)
+    {
+        if(depth-- == 0)
+        {
+            std::make_heap(first, last, comp);
+            std::sort_heap(first, last, comp);
+            return;
+        }
+        RandomIt middle = detail::partition(first, last, comp);
+        RandomIt small_first = first, small_last = middle;
+        if(middle - first > last - middle)
+        {
+            small_first = middle;
+            small_last = last;
+            last = middle;
+        }
+        else
+        {
+            first = middle;
+        }
+        if(detail::dispatch(small_first, small_last, first, last, comp, depth))
+        {
+            return;
+        }
+        detail::sort(small_first, small_last, comp, depth);
+    }
+    detail::insertion_sort(first, last, comp);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Configure outro sort. This is independent of the configuration of the C
+/// implementation.
+///
+/// `available_threads` is the maximum number of simultaneously active
+/// threads. `multithreading_threshold` is the minimum size of a subarray for
+/// which multithreading should be used. Worker threads are created the first
+/// time they are needed and then kept (idle) until the program exits, so only
+/// the first multithreaded sorts pay for creating them.
+///////////////////////////////////////////////////////////////////////////////
+inline void configure(int available_threads, std::size_t multithreading_threshold)
+{
+    detail::available_threads().store(available_threads);
+    detail::multithreading_threshold().store(static_cast<std::ptrdiff_t>(multithreading_threshold));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Sort a range using outro sort. This is a drop-in replacement for
+/// `std::sort`: the sort is not stable, and the comparator must induce a
+/// strict weak ordering. If it throws, the exception is propagated after all
+/// threads have been joined, leaving the range in an unspecified order.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt, typename Compare>
+void sort(RandomIt first, RandomIt last, Compare comp)
+{
+    detail::sort(first, last, comp, detail::depth_limit(first, last));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Sort a range in ascending order using outro sort.
+///////////////////////////////////////////////////////////////////////////////
+template <typename RandomIt>
+void sort(RandomIt first, RandomIt last)
+{
+    outro::sort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+}
+
+#endif  // TFPF_VERSATILE_SORT_OUTRO_SORT_OUTRO_SORT_HH_
@@ -0,0 +1,1946 @@
+// Generic implementation of outro sort. This file has no include guard: it is
+// meant to be included once for every element type a sort function should be
+// generated for, with the following macros defined.
+//
+// OUTRO_SORT_TYPE Element type.
+// OUTRO_SORT_SUFFIX Suffix appended to the names of the generated functions.
+//     May be empty.
+// OUTRO_SORT_KEY_TYPE (optional) Type of the sort key, which must be
+//     comparable using the relational operators. Defaults to the element
+//     type, in which case elements are compared directly.
+// OUTRO_SORT_KEY_OFFSET (optional) Offset of the sort key in an element, for
+//     sorting records by one of their members.
+// OUTRO_SORT_RADIX_TYPE (optional) Unsigned integer type, the values of which
+//     can be ordered in the same way as keys. If defined, radix sort is also
+//     generated, and used automatically for large arrays.
+// OUTRO_SORT_RADIX_KEY (optional) Function-like macro which maps a key to a
+//     value of the above type. Required if the above is defined.
+// OUTRO_SORT_PARTITION_KERNEL (optional) Function which partitions a subarray
+//     around a given pivot faster than the generic code, returning the
+//     partition pointer, or `NULL` if it cannot be used.
+// OUTRO_SORT_NETWORK_KERNEL (optional) Function which sorts a subarray of at
+//     most 16 elements faster than the generic sorting network, returning 0,
+//     or -1 if it cannot be used.
+//
+// The state used to select the least elements of a stream must be defined
+// (using `OUTRO_SORT_DECLARE` from `outro_sort.h`) before this file is
+// included.
+//
+// All of these are undefined at the end of this file.
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "pool.h"
+#include "stats.h"
+
+#define OUTRO_SORT_CONCAT_(a, b) a##b
+#define OUTRO_SORT_CONCAT(a, b) OUTRO_SORT_CONCAT_(a, b)
+#define OUTRO_SORT_NAME(name) OUTRO_SORT_CONCAT(name, OUTRO_SORT_SUFFIX)
+
+#ifndef OUTRO_SORT_KEY_TYPE
+#define OUTRO_SORT_KEY_TYPE OUTRO_SORT_TYPE
+#endif
+
+/******************************************************************************
+ * Obtain the sort key of an element.
+ *
+ * @param elem
+ *
+ * @return Key.
+ *****************************************************************************/
+static inline OUTRO_SORT_KEY_TYPE
+OUTRO_SORT_NAME(outro_sort_key)(OUTRO_SORT_TYPE const *elem)
+{
+#ifdef OUTRO_SORT_KEY_OFFSET
+    OUTRO_SORT_KEY_TYPE key;
+    memcpy(&key, (char const *)elem + OUTRO_SORT_KEY_OFFSET, sizeof key);
+    return key;
+#else
+    return *elem;
+#endif
+}
+
+/******************************************************************************
+ * Exchange the elements stored at the given addresses.
+ *
+ * @param a
+ * @param b
+ *****************************************************************************/
+static inline void
+OUTRO_SORT_NAME(outro_sort_swap)(OUTRO_SORT_TYPE *a, OUTRO_SORT_TYPE *b)
+{
+    OUTRO_SORT_TYPE tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using insertion sort.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+void
+OUTRO_SORT_NAME(insertion_sort)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    if(begin + 1 >= end)
+    {
+        return;
+    }
+    for(OUTRO_SORT_TYPE *curr = begin + 1; curr < end; ++curr)
+    {
+        OUTRO_SORT_TYPE val = *curr;
+        OUTRO_SORT_KEY_TYPE key = OUTRO_SORT_NAME(outro_sort_key)(&val);
+        OUTRO_SORT_TYPE *gap = curr;
+        for(; gap > begin && OUTRO_SORT_NAME(outro_sort_key)(gap - 1) > key; --gap)
+        {
+            *gap = *(gap - 1);
+        }
+        *gap = val;
+    }
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using insertion sort, but give up if that
+ * requires moving many elements.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *
+ * @return 1 if the subarray was sorted, else 0.
+ *****************************************************************************/
+static int
+OUTRO_SORT_NAME(outro_sort_insertion_sort_bounded)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    if(begin + 1 >= end)
+    {
+        return 1;
+    }
+    size_t moves = 0;
+    for(OUTRO_SORT_TYPE *curr = begin + 1; curr < end; ++curr)
+    {
+        OUTRO_SORT_TYPE val = *curr;
+        OUTRO_SORT_KEY_TYPE key = OUTRO_SORT_NAME(outro_sort_key)(&val);
+        OUTRO_SORT_TYPE *gap = curr;
+        for(; gap > begin && OUTRO_SORT_NAME(outro_sort_key)(gap - 1) > key; --gap)
+        {
+            *gap = *(gap - 1);
+        }
+        *gap = val;
+        moves += curr - gap;
+        if(moves > 8)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/******************************************************************************
+ * Reverse a subarray if its elements are in descending order.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *
+ * @return 1 if the subarray was reversed (and is hence sorted), else 0.
+ *****************************************************************************/
+static int
+OUTRO_SORT_NAME(outro_sort_reverse_descending)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    for(OUTRO_SORT_TYPE *curr = begin + 1; curr < end; ++curr)
+    {
+        if(OUTRO_SORT_NAME(outro_sort_key)(curr - 1) < OUTRO_SORT_NAME(outro_sort_key)(curr))
+        {
+            return 0;
+        }
+    }
+    for(--end; begin < end; ++begin, --end)
+    {
+        OUTRO_SORT_NAME(outro_sort_swap)(begin, end);
+    }
+    return 1;
+}
+
+#ifndef TFPF_VERSATILE_SORT_OUTRO_SORT_NETWORK_
+#define TFPF_VERSATILE_SORT_OUTRO_SORT_NETWORK_
+// Comparators of Green's sorting network for 16 elements, in the order of its
+// layers. The network obtained by removing all comparators touching positions
+// greater than or equal to n sorts n elements, because the removed positions
+// can be thought of as holding the greatest elements, which are never moved.
+static unsigned char const outro_sort_comparators[][2] = {
+    {0, 13}, {1, 12}, {2, 15}, {3, 14}, {4, 8}, {5, 6}, {7, 11}, {9, 10},
+    {0, 5}, {1, 7}, {2, 9}, {3, 4}, {6, 13}, {8, 14}, {10, 15}, {11, 12},
+    {0, 1}, {2, 3}, {4, 5}, {6, 8}, {7, 9}, {10, 11}, {12, 13}, {14, 15},
+    {0, 2}, {1, 3}, {4, 10}, {5, 11}, {6, 7}, {8, 9}, {12, 14}, {13, 15},
+    {1, 2}, {3, 12}, {4, 6}, {5, 7}, {8, 10}, {9, 11}, {13, 14},
+    {1, 4}, {2, 6}, {5, 8}, {7, 10}, {9, 13}, {11, 14},
+    {2, 4}, {3, 6}, {9, 12}, {11, 13},
+    {3, 5}, {6, 8}, {7, 9}, {10, 12},
+    {3, 4}, {5, 6}, {7, 8}, {9, 10}, {11, 12},
+    {6, 7}, {8, 9},
+};
+#endif
+
+/******************************************************************************
+ * Sort the elements of a subarray of at most 16 elements using a sorting
+ * network. Every comparator is evaluated without branching on the keys.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_network)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+#ifdef OUTRO_SORT_NETWORK_KERNEL
+    if(OUTRO_SORT_NETWORK_KERNEL(begin, end) == 0)
+    {
+        return;
+    }
+#endif
+    ptrdiff_t size = end - begin;
+    for(size_t i = 0; i < sizeof outro_sort_comparators / sizeof *outro_sort_comparators; ++i)
+    {
+        if(outro_sort_comparators[i][1] >= size)
+        {
+            continue;
+        }
+        OUTRO_SORT_TYPE *a = begin + outro_sort_comparators[i][0], *b = begin + outro_sort_comparators[i][1];
+        OUTRO_SORT_TYPE x = *a, y = *b;
+        int less = OUTRO_SORT_NAME(outro_sort_key)(&y) < OUTRO_SORT_NAME(outro_sort_key)(&x);
+        *a = less ? y : x;
+        *b = less ? x : y;
+    }
+}
+
+/******************************************************************************
+ * Pick a pivot. Try to avoid the least and greatest keys.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *
+ * @return Key of the pivot.
+ *****************************************************************************/
+static OUTRO_SORT_KEY_TYPE
+OUTRO_SORT_NAME(outro_sort_pivot)(OUTRO_SORT_TYPE const *begin, OUTRO_SORT_TYPE const *end)
+{
+    OUTRO_SORT_TYPE const *middle = (end - 1 - begin) / 2 + begin;
+    OUTRO_SORT_KEY_TYPE val[] = {
+        OUTRO_SORT_NAME(outro_sort_key)(begin),
+        OUTRO_SORT_NAME(outro_sort_key)(middle),
+        OUTRO_SORT_NAME(outro_sort_key)(end - 1),
+    };
+    OUTRO_SORT_KEY_TYPE tmp;
+    if(val[0] > val[1])
+    {
+        tmp = val[0];
+        val[0] = val[1];
+        val[1] = tmp;
+    }
+    if(val[0] > val[2])
+    {
+        tmp = val[0];
+        val[0] = val[2];
+        val[2] = tmp;
+    }
+    return val[1] < val[2] ? val[1] : val[2];
+}
+
+/******************************************************************************
+ * Apply Hoare's partioning scheme to a subarray: group all elements less than
+ * the pivot (and possibly some elements equal to it) on one side of the pivot.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param pivot_val Pivot, which must be the key of one of the elements.
+ *
+ * @return Partition pointer. All elements at lower addresses will be less than
+ *     or equal to the pivot.
+ *****************************************************************************/
+static OUTRO_SORT_TYPE *
+OUTRO_SORT_NAME(outro_sort_partition_hoare)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, OUTRO_SORT_KEY_TYPE pivot_val)
+{
+    for(;; ++begin, --end)
+    {
+        while(OUTRO_SORT_NAME(outro_sort_key)(begin) < pivot_val)
+        {
+            ++begin;
+        }
+        while(OUTRO_SORT_NAME(outro_sort_key)(end - 1) > pivot_val)
+        {
+            --end;
+        }
+        if(begin + 1 >= end)
+        {
+            return end;
+        }
+        OUTRO_SORT_NAME(outro_sort_swap)(begin, end - 1);
+    }
+}
+
+/******************************************************************************
+ * Group all elements equal to the pivot on one side of the others. The pivot
+ * must be the least key.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param pivot_val Pivot.
+ *
+ * @return Partition pointer. All elements at lower addresses will be equal to
+ *     the pivot, and all others will be greater.
+ *****************************************************************************/
+static OUTRO_SORT_TYPE *
+OUTRO_SORT_NAME(outro_sort_partition_equal)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, OUTRO_SORT_KEY_TYPE pivot_val)
+{
+    for(;; ++begin, --end)
+    {
+        while(begin < end && !(OUTRO_SORT_NAME(outro_sort_key)(begin) > pivot_val))
+        {
+            ++begin;
+        }
+        while(begin < end && OUTRO_SORT_NAME(outro_sort_key)(end - 1) > pivot_val)
+        {
+            --end;
+        }
+        if(begin >= end)
+        {
+            return begin;
+        }
+        OUTRO_SORT_NAME(outro_sort_swap)(begin, end - 1);
+    }
+}
+
+// Number of elements examined at a time from each end by block partitioning.
+#define OUTRO_SORT_BLOCK_SIZE 64
+
+/******************************************************************************
+ * Apply block partitioning to a subarray. This has the same effect as Hoare's
+ * partitioning scheme, but without branches which depend on the keys. Blocks
+ * of elements are examined from both ends, and the offsets of those which
+ * belong on the other side are recorded. Then as many of them as possible are
+ * exchanged. Whatever is left in the middle is partitioned like Hoare's
+ * scheme, with bounds checks.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param pivot_val Pivot, which must be the key of one of the elements.
+ *
+ * @return Partition pointer. All elements at lower addresses will be less than
+ *     or equal to the pivot.
+ *****************************************************************************/
+static OUTRO_SORT_TYPE *
+OUTRO_SORT_NAME(outro_sort_partition_block)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, OUTRO_SORT_KEY_TYPE pivot_val)
+{
+    unsigned char offsets_left[OUTRO_SORT_BLOCK_SIZE], offsets_right[OUTRO_SORT_BLOCK_SIZE];
+    int start_left = 0, start_right = 0, num_left = 0, num_right = 0;
+    OUTRO_SORT_TYPE *left = begin, *right = end;
+    while(right - left >= 2 * OUTRO_SORT_BLOCK_SIZE)
+    {
+        if(num_left == 0)
+        {
+            start_left = 0;
+            for(int i = 0; i < OUTRO_SORT_BLOCK_SIZE; ++i)
+            {
+                offsets_left[num_left] = i;
+                num_left += !(OUTRO_SORT_NAME(outro_sort_key)(left + i) < pivot_val);
+            }
+        }
+        if(num_right == 0)
+        {
+            start_right = 0;
+            for(int i = 0; i < OUTRO_SORT_BLOCK_SIZE; ++i)
+            {
+                offsets_right[num_right] = i;
+                num_right += !(OUTRO_SORT_NAME(outro_sort_key)(right - 1 - i) > pivot_val);
+            }
+        }
+        int num = num_left < num_right ? num_left : num_right;
+        for(int i = 0; i < num; ++i)
+        {
+            OUTRO_SORT_NAME(outro_sort_swap)(left + offsets_left[start_left + i], right - 1 - offsets_right[start_right + i]);
+        }
+        num_left -= num;
+        num_right -= num;
+        start_left += num;
+        start_right += num;
+        if(num_left == 0)
+        {
+            left += OUTRO_SORT_BLOCK_SIZE;
+        }
+        if(num_right == 0)
+        {
+            right -= OUTRO_SORT_BLOCK_SIZE;
+        }
+    }
+
+    // All elements before the left block are less than or equal to the pivot,
+    // and all elements after the right block are greater than or equal to it.
+    // If at least one block was completed on each side, both parts are
+    // guaranteed to be non-empty. Otherwise, at least two elements on each
+    // side of the pivot (the other candidates) ensure the same.
+    for(;; ++left, --right)
+    {
+        while(left < right && OUTRO_SORT_NAME(outro_sort_key)(left) < pivot_val)
+        {
+            ++left;
+        }
+        while(left < right && OUTRO_SORT_NAME(outro_sort_key)(right - 1) > pivot_val)
+        {
+            --right;
+        }
+        if(left + 1 >= right)
+        {
+            return left < right && left == begin ? right : left;
+        }
+        OUTRO_SORT_NAME(outro_sort_swap)(left, right - 1);
+    }
+}
+
+// Minimum number of elements in each chunk partitioned by a different thread.
+#define OUTRO_SORT_PARTITION_CHUNK_SIZE 65536U
+
+// Part of a subarray partitioned by one thread during parallel partitioning.
+struct OUTRO_SORT_NAME(OutroSortPartitionChunk)
+{
+    OUTRO_SORT_TYPE *begin;
+    OUTRO_SORT_TYPE *end;
+    OUTRO_SORT_KEY_TYPE pivot_val;
+
+    // Partition pointer of the chunk.
+    OUTRO_SORT_TYPE *ploc;
+
+    // Partition pointer of the subarray, and the range of indices of the
+    // misplaced elements this thread exchanges.
+    OUTRO_SORT_TYPE *split;
+    size_t first;
+    size_t last;
+    struct OUTRO_SORT_NAME(OutroSortPartitionChunk) *chunks;
+    int num_chunks;
+};
+
+/******************************************************************************
+ * Partition a chunk.
+ *
+ * @param chunk_ Chunk.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_partition_chunk)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortPartitionChunk) *chunk = chunk_;
+    chunk->ploc = OUTRO_SORT_NAME(outro_sort_partition_block)(chunk->begin, chunk->end, chunk->pivot_val);
+}
+
+/******************************************************************************
+ * Find a misplaced element after all chunks have been partitioned. Elements
+ * on the right side of the partition pointer of their chunk but before the
+ * partition pointer of the subarray are misplaced high. Elements on the left
+ * side of the partition pointer of their chunk but at or after the partition
+ * pointer of the subarray are misplaced low.
+ *
+ * @param chunk Any chunk.
+ * @param high Whether to find an element misplaced high or low.
+ * @param index Number of elements misplaced the same way before the one to
+ *     find. Must be less than the total number of such elements.
+ * @param stop Set to one past the last element of the contiguous range of
+ *     misplaced elements containing the one found.
+ *
+ * @return Pointer to the element.
+ *****************************************************************************/
+static OUTRO_SORT_TYPE *
+OUTRO_SORT_NAME(outro_sort_misplaced)(struct OUTRO_SORT_NAME(OutroSortPartitionChunk) const *chunk, int high, size_t index, OUTRO_SORT_TYPE **stop)
+{
+    OUTRO_SORT_TYPE *split = chunk->split;
+    for(struct OUTRO_SORT_NAME(OutroSortPartitionChunk) const *curr = chunk->chunks;; ++curr)
+    {
+        OUTRO_SORT_TYPE *first = high ? curr->ploc : curr->begin > split ? curr->begin : split;
+        OUTRO_SORT_TYPE *last = high ? curr->end < split ? curr->end : split : curr->ploc;
+        if(first < last && index < (size_t)(last - first))
+        {
+            *stop = last;
+            return first + index;
+        }
+        if(first < last)
+        {
+            index -= last - first;
+        }
+    }
+}
+
+/******************************************************************************
+ * Exchange the elements misplaced high with those misplaced low in the range
+ * of indices assigned to a chunk.
+ *
+ * @param chunk_ Chunk.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_partition_fix)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortPartitionChunk) *chunk = chunk_;
+    if(chunk->first >= chunk->last)
+    {
+        return;
+    }
+    OUTRO_SORT_TYPE *high_stop, *low_stop;
+    OUTRO_SORT_TYPE *high = OUTRO_SORT_NAME(outro_sort_misplaced)(chunk, 1, chunk->first, &high_stop);
+    OUTRO_SORT_TYPE *low = OUTRO_SORT_NAME(outro_sort_misplaced)(chunk, 0, chunk->first, &low_stop);
+    for(size_t i = chunk->first; i < chunk->last; ++i)
+    {
+        OUTRO_SORT_NAME(outro_sort_swap)(high++, low++);
+        if(i + 1 < chunk->last && high == high_stop)
+        {
+            high = OUTRO_SORT_NAME(outro_sort_misplaced)(chunk, 1, i + 1, &high_stop);
+        }
+        if(i + 1 < chunk->last && low == low_stop)
+        {
+            low = OUTRO_SORT_NAME(outro_sort_misplaced)(chunk, 0, i + 1, &low_stop);
+        }
+    }
+}
+
+/******************************************************************************
+ * Partition a large subarray using multiple threads. It is split into chunks,
+ * each of which is partitioned by a different thread. The elements which are
+ * then on the wrong side of the partition pointer of the whole subarray are
+ * exchanged, also by multiple threads.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param pivot_val Pivot, which must be the key of one of the elements.
+ *
+ * @return Partition pointer, or `NULL` if fewer than two threads are
+ *     available, or if either part would be empty. In the latter case, the
+ *     subarray may have been rearranged.
+ *****************************************************************************/
+static OUTRO_SORT_TYPE *
+OUTRO_SORT_NAME(outro_sort_partition_parallel)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, OUTRO_SORT_KEY_TYPE pivot_val)
+{
+    size_t size = end - begin;
+    int num_chunks = outro_sort_concurrency();
+    if(num_chunks > OUTRO_SORT_RUN_MAX)
+    {
+        num_chunks = OUTRO_SORT_RUN_MAX;
+    }
+    if((size_t)num_chunks > size / OUTRO_SORT_PARTITION_CHUNK_SIZE)
+    {
+        num_chunks = size / OUTRO_SORT_PARTITION_CHUNK_SIZE;
+    }
+    if(num_chunks < 2)
+    {
+        return NULL;
+    }
+
+    struct OUTRO_SORT_NAME(OutroSortPartitionChunk) chunks[OUTRO_SORT_RUN_MAX];
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].begin = begin + size * i / num_chunks;
+        chunks[i].end = begin + size * (i + 1) / num_chunks;
+        chunks[i].pivot_val = pivot_val;
+    }
+    outro_sort_run(OUTRO_SORT_NAME(outro_sort_partition_chunk), chunks, sizeof *chunks, num_chunks, size / num_chunks);
+
+    OUTRO_SORT_TYPE *split = begin;
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        split += chunks[i].ploc - chunks[i].begin;
+    }
+    if(split == begin || split == end)
+    {
+        return NULL;
+    }
+    size_t misplaced = 0;
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        if(chunks[i].ploc < split)
+        {
+            misplaced += (chunks[i].end < split ? chunks[i].end : split) - chunks[i].ploc;
+        }
+    }
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].split = split;
+        chunks[i].first = misplaced * i / num_chunks;
+        chunks[i].last = misplaced * (i + 1) / num_chunks;
+        chunks[i].chunks = chunks;
+        chunks[i].num_chunks = num_chunks;
+    }
+    outro_sort_run(OUTRO_SORT_NAME(outro_sort_partition_fix), chunks, sizeof *chunks, num_chunks, misplaced / num_chunks);
+    return split;
+}
+
+/******************************************************************************
+ * Partition a subarray using the method selected by
+ * `outro_sort_configure_partition`. If no element is on the wrong side of the
+ * pivot, nothing is moved.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param pivot_val Pivot, which must be selected by `outro_sort_pivot`.
+ * @param partitioned Set to 1 if the subarray was already partitioned, else 0.
+ *
+ * @return Partition pointer. All elements at lower addresses will be less than
+ *     or equal to the pivot, and neither part will be empty.
+ *****************************************************************************/
+static OUTRO_SORT_TYPE *
+OUTRO_SORT_NAME(outro_sort_partition)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, OUTRO_SORT_KEY_TYPE pivot_val, int *partitioned)
+{
+    // The median of three keys is neither greater nor less than all of them,
+    // so these scans stop within the subarray, and do not stop at its ends
+    // if they meet.
+    OUTRO_SORT_TYPE *left = begin, *right = end;
+    while(OUTRO_SORT_NAME(outro_sort_key)(left) < pivot_val)
+    {
+        ++left;
+    }
+    while(OUTRO_SORT_NAME(outro_sort_key)(right - 1) > pivot_val)
+    {
+        --right;
+    }
+    *partitioned = right <= left + 1;
+    if(*partitioned)
+    {
+        return left;
+    }
+    struct OutroSortContext const *settings = outro_sort_settings();
+    if(settings->parallel_partition_threshold > 0 && begin + settings->parallel_partition_threshold <= end)
+    {
+        OUTRO_SORT_TYPE *ploc = OUTRO_SORT_NAME(outro_sort_partition_parallel)(begin, end, pivot_val);
+        if(ploc != NULL)
+        {
+            return ploc;
+        }
+    }
+#ifdef OUTRO_SORT_PARTITION_KERNEL
+    OUTRO_SORT_TYPE *ploc = OUTRO_SORT_PARTITION_KERNEL(begin, end, pivot_val);
+    if(ploc != NULL)
+    {
+        return ploc;
+    }
+#endif
+    if(settings->partition == OUTRO_SORT_PARTITION_HOARE)
+    {
+        return OUTRO_SORT_NAME(outro_sort_partition_hoare)(begin, end, pivot_val);
+    }
+    return OUTRO_SORT_NAME(outro_sort_partition_block)(begin, end, pivot_val);
+}
+
+#ifdef OUTRO_SORT_RADIX_TYPE
+// Radix sort processes these many bits of the keys in each pass.
+#define OUTRO_SORT_RADIX_BITS 8
+#define OUTRO_SORT_RADIX_BUCKETS (1 << OUTRO_SORT_RADIX_BITS)
+#define OUTRO_SORT_RADIX_PASSES (int)(sizeof(OUTRO_SORT_RADIX_TYPE) * CHAR_BIT / OUTRO_SORT_RADIX_BITS)
+
+// Maximum number of threads radix sort is split across, and the minimum
+// number of elements each of them should process.
+#define OUTRO_SORT_RADIX_CHUNKS OUTRO_SORT_RUN_MAX
+#define OUTRO_SORT_RADIX_CHUNK_SIZE 65536U
+
+// Part of an array processed by one thread during radix sort.
+struct OUTRO_SORT_NAME(OutroSortRadixChunk)
+{
+    OUTRO_SORT_TYPE *src;
+    OUTRO_SORT_TYPE *dst;
+    size_t begin;
+    size_t end;
+
+    // Pass to count or scatter the digits of. Negative to count the digits
+    // of all passes.
+    int pass;
+
+    // Number of elements in each bucket in each pass. Overwritten with the
+    // positions to scatter elements to.
+    size_t (*counts)[OUTRO_SORT_RADIX_BUCKETS];
+};
+
+/******************************************************************************
+ * Obtain the digit of the key of an element which radix sort uses in a pass.
+ *
+ * @param elem
+ * @param pass
+ *
+ * @return Digit.
+ *****************************************************************************/
+static inline size_t
+OUTRO_SORT_NAME(outro_sort_digit)(OUTRO_SORT_TYPE const *elem, int pass)
+{
+    OUTRO_SORT_RADIX_TYPE radix_key = OUTRO_SORT_RADIX_KEY(OUTRO_SORT_NAME(outro_sort_key)(elem));
+    return radix_key >> pass * OUTRO_SORT_RADIX_BITS & (OUTRO_SORT_RADIX_BUCKETS - 1);
+}
+
+/******************************************************************************
+ * Count the digits of the elements in a chunk.
+ *
+ * @param chunk_ Chunk.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_radix_count)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortRadixChunk) *chunk = chunk_;
+    size_t (*counts)[OUTRO_SORT_RADIX_BUCKETS] = chunk->counts;
+    if(chunk->pass >= 0)
+    {
+        memset(counts[chunk->pass], 0, sizeof *counts);
+        for(size_t i = chunk->begin; i < chunk->end; ++i)
+        {
+            ++counts[chunk->pass][OUTRO_SORT_NAME(outro_sort_digit)(chunk->src + i, chunk->pass)];
+        }
+        return;
+    }
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        OUTRO_SORT_RADIX_TYPE radix_key = OUTRO_SORT_RADIX_KEY(OUTRO_SORT_NAME(outro_sort_key)(chunk->src + i));
+        for(int pass = 0; pass < OUTRO_SORT_RADIX_PASSES; ++pass)
+        {
+            ++counts[pass][radix_key >> pass * OUTRO_SORT_RADIX_BITS & (OUTRO_SORT_RADIX_BUCKETS - 1)];
+        }
+    }
+}
+
+/******************************************************************************
+ * Move the elements in a chunk to the positions computed from the counts of
+ * their digits. Elements with the same digit retain their order.
+ *
+ * @param chunk_ Chunk.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_radix_scatter)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortRadixChunk) *chunk = chunk_;
+    size_t *positions = chunk->counts[chunk->pass];
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        chunk->dst[positions[OUTRO_SORT_NAME(outro_sort_digit)(chunk->src + i, chunk->pass)]++] = chunk->src[i];
+    }
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using least significant digit radix sort.
+ * Large subarrays are split into chunks processed by different threads, which
+ * count the digits of their elements independently, and then move them to
+ * disjoint sets of positions. Passes in which all keys have the same digit
+ * are skipped. If the asynchronous sort this is part of is cancelled, no
+ * further passes are made.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *
+ * @return 0 if the subarray was sorted, else -1, in which case memory could
+ *     not be allocated, and the subarray is unchanged.
+ *****************************************************************************/
+int
+OUTRO_SORT_NAME(radix_sort)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    size_t size = end - begin;
+    int num_chunks = outro_sort_concurrency();
+    if(num_chunks > OUTRO_SORT_RADIX_CHUNKS)
+    {
+        num_chunks = OUTRO_SORT_RADIX_CHUNKS;
+    }
+    if((size_t)num_chunks > size / OUTRO_SORT_RADIX_CHUNK_SIZE)
+    {
+        num_chunks = size / OUTRO_SORT_RADIX_CHUNK_SIZE > 0 ? size / OUTRO_SORT_RADIX_CHUNK_SIZE : 1;
+    }
+    OUTRO_SORT_TYPE *buffer = outro_sort_scratch_alloc(size * sizeof *buffer);
+    size_t (*counts)[OUTRO_SORT_RADIX_PASSES][OUTRO_SORT_RADIX_BUCKETS] = calloc(num_chunks, sizeof *counts);
+    if(buffer == NULL || counts == NULL)
+    {
+        free(counts);
+        outro_sort_scratch_free(buffer);
+        return -1;
+    }
+
+    struct OUTRO_SORT_NAME(OutroSortRadixChunk) chunks[OUTRO_SORT_RADIX_CHUNKS];
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].src = begin;
+        chunks[i].begin = size * i / num_chunks;
+        chunks[i].end = size * (i + 1) / num_chunks;
+        chunks[i].pass = -1;
+        chunks[i].counts = counts[i];
+    }
+    outro_sort_run(OUTRO_SORT_NAME(outro_sort_radix_count), chunks, sizeof *chunks, num_chunks, size / num_chunks);
+
+    // The totals of the counts do not depend on the order of the elements, so
+    // they can be used to skip passes. The counts of the individual chunks,
+    // however, must be recomputed after elements are moved.
+    OUTRO_SORT_TYPE *src = begin, *dst = buffer;
+    int counted = 1;
+    for(int pass = 0; pass < OUTRO_SORT_RADIX_PASSES; ++pass)
+    {
+        size_t digit = OUTRO_SORT_NAME(outro_sort_digit)(src, pass), same = 0;
+        for(int i = 0; i < num_chunks; ++i)
+        {
+            same += counts[i][pass][digit];
+        }
+        if(same == size)
+        {
+            continue;
+        }
+        if(outro_sort_cancelled())
+        {
+            break;
+        }
+        for(int i = 0; i < num_chunks; ++i)
+        {
+            chunks[i].src = src;
+            chunks[i].dst = dst;
+            chunks[i].pass = pass;
+        }
+        if(!counted)
+        {
+            outro_sort_run(OUTRO_SORT_NAME(outro_sort_radix_count), chunks, sizeof *chunks, num_chunks, size / num_chunks);
+        }
+        size_t position = 0;
+        for(size_t bucket = 0; bucket < OUTRO_SORT_RADIX_BUCKETS; ++bucket)
+        {
+            for(int i = 0; i < num_chunks; ++i)
+            {
+                size_t count = counts[i][pass][bucket];
+                counts[i][pass][bucket] = position;
+                position += count;
+            }
+        }
+        outro_sort_run(OUTRO_SORT_NAME(outro_sort_radix_scatter), chunks, sizeof *chunks, num_chunks, size / num_chunks);
+        OUTRO_SORT_TYPE *tmp = src;
+        src = dst;
+        dst = tmp;
+        counted = num_chunks == 1;
+    }
+    if(src != begin)
+    {
+        memcpy(begin, src, size * sizeof *begin);
+    }
+    free(counts);
+    outro_sort_scratch_free(buffer);
+    return 0;
+}
+
+#undef OUTRO_SORT_RADIX_BITS
+#undef OUTRO_SORT_RADIX_BUCKETS
+#undef OUTRO_SORT_RADIX_PASSES
+#undef OUTRO_SORT_RADIX_CHUNKS
+#undef OUTRO_SORT_RADIX_CHUNK_SIZE
+#endif
+
+/******************************************************************************
+ * Move an element down a max-heap until neither of its children has a greater
+ * key.
+ *
+ * @param begin Pointer to the first element of the heap.
+ * @param size Number of elements in the heap.
+ * @param root Index of the element to move.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_sift_down)(OUTRO_SORT_TYPE *begin, size_t size, size_t root)
+{
+    OUTRO_SORT_TYPE val = begin[root];
+    OUTRO_SORT_KEY_TYPE key = OUTRO_SORT_NAME(outro_sort_key)(&val);
+    for(size_t child; (child = 2 * root + 1) < size; root = child)
+    {
+        if(child + 1 < size && OUTRO_SORT_NAME(outro_sort_key)(begin + child) < OUTRO_SORT_NAME(outro_sort_key)(begin + child + 1))
+        {
+            ++child;
+        }
+        if(!(key < OUTRO_SORT_NAME(outro_sort_key)(begin + child)))
+        {
+            break;
+        }
+        begin[root] = begin[child];
+    }
+    begin[root] = val;
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using heap sort, without recursion.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_heap_sort)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    size_t size = end - begin;
+    for(size_t i = size / 2; i-- > 0;)
+    {
+        OUTRO_SORT_NAME(outro_sort_sift_down)(begin, size, i);
+    }
+    for(size_t i = size; i-- > 1;)
+    {
+        OUTRO_SORT_NAME(outro_sort_swap)(begin, begin + i);
+        OUTRO_SORT_NAME(outro_sort_sift_down)(begin, i, 0);
+    }
+}
+
+#ifndef TFPF_VERSATILE_SORT_OUTRO_SORT_DEPTH_LIMIT_
+#define TFPF_VERSATILE_SORT_OUTRO_SORT_DEPTH_LIMIT_
+/******************************************************************************
+ * Obtain the number of times a subarray may be partitioned before it is
+ * considered to be a bad case for quick sort.
+ *
+ * @param size Number of elements in the subarray.
+ *
+ * @return Twice the binary logarithm of the size, rounded down.
+ *****************************************************************************/
+static inline int
+outro_sort_depth_limit(size_t size)
+{
+    int depth_limit = 0;
+    for(; size > 1; size >>= 1)
+    {
+        depth_limit += 2;
+    }
+    return depth_limit;
+}
+#endif
+
+static void OUTRO_SORT_NAME(outro_sort_loop)(OUTRO_SORT_TYPE *, OUTRO_SORT_TYPE *, int, OUTRO_SORT_KEY_TYPE const *);
+
+// Part of a partition sorted as a task, with the number of times it may still
+// be partitioned and a copy of the key which bounded it (if any), since the
+// dispatching thread goes on to change its own.
+struct OUTRO_SORT_NAME(OutroSortPart)
+{
+    OUTRO_SORT_TYPE *begin;
+    OUTRO_SORT_TYPE *end;
+    int depth;
+    int bounded;
+    OUTRO_SORT_KEY_TYPE lower_val;
+};
+
+/******************************************************************************
+ * Fill in a part of a partition to be sorted as a task.
+ *
+ * @param part Part to fill in.
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param depth Number of times the part may still be partitioned.
+ * @param lower Pointer to a key not greater than any key in the part, or
+ *     `NULL`.
+ *****************************************************************************/
+static inline void
+OUTRO_SORT_NAME(outro_sort_part)(struct OUTRO_SORT_NAME(OutroSortPart) *part, OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, int depth, OUTRO_SORT_KEY_TYPE const *lower)
+{
+    part->begin = begin;
+    part->end = end;
+    part->depth = depth;
+    part->bounded = lower != NULL;
+    if(lower != NULL)
+    {
+        part->lower_val = *lower;
+    }
+}
+
+/******************************************************************************
+ * Helper function to perform outro sort as a task. The part continues with the
+ * depth limit and bound it had in the dispatching thread, so that dispatching
+ * it does not reset the depth limit of a bad case for quick sort.
+ *
+ * @param part_ Part of a partition.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_task)(void *part_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortPart) *part = part_;
+    outro_sort_stats_enter();
+    OUTRO_SORT_NAME(outro_sort_loop)(part->begin, part->end, part->depth, part->bounded ? &part->lower_val : NULL);
+    outro_sort_stats_leave();
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using outro sort. The smaller part of each
+ * partition is sorted first (or dispatched), and the larger part by the same
+ * call, so that the stack depth is logarithmic in the size. If the subarray
+ * has been partitioned too many times, it is sorted using heap sort instead.
+ *
+ * Patterns are exploited as in pattern-defeating quick sort. Descending
+ * subarrays are reversed. If partitioning does not move any element, the
+ * subarray may be nearly sorted, so insertion sort is tried on both parts,
+ * giving up after a few moves. If the pivot is equal to the previous pivot
+ * (which cannot be greater than any key in the subarray), all elements equal
+ * to it are moved to the front and skipped, so that many duplicates are
+ * sorted in linear time.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param depth Number of times the subarray may still be partitioned.
+ * @param lower Pointer to a key not greater than any key in the subarray, or
+ *     `NULL`.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_loop)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, int depth, OUTRO_SORT_KEY_TYPE const *lower)
+{
+    struct OutroSortContext const *settings = outro_sort_settings();
+    OUTRO_SORT_KEY_TYPE lower_val;
+    for(;;)
+    {
+        if(outro_sort_cancelled())
+        {
+            return;
+        }
+        size_t size = end - begin;
+        if(size <= settings->leaf_size)
+        {
+            outro_sort_stats_begin(OUTRO_SORT_PHASE_LEAF);
+            if(size <= 16)
+            {
+                OUTRO_SORT_NAME(outro_sort_network)(begin, end);
+            }
+            else
+            {
+                OUTRO_SORT_NAME(insertion_sort)(begin, end);
+            }
+            outro_sort_stats_end();
+            return;
+        }
+#ifdef OUTRO_SORT_RADIX_TYPE
+        if(settings->radix_threshold > 0 && size >= settings->radix_threshold)
+        {
+            if(OUTRO_SORT_NAME(radix_sort)(begin, end) == 0)
+            {
+                return;
+            }
+        }
+#endif
+        if(depth-- == 0)
+        {
+            OUTRO_SORT_NAME(outro_sort_heap_sort)(begin, end);
+            return;
+        }
+        if(OUTRO_SORT_NAME(outro_sort_key)(begin) > OUTRO_SORT_NAME(outro_sort_key)(end - 1) && OUTRO_SORT_NAME(outro_sort_reverse_descending)(begin, end))
+        {
+            return;
+        }
+        OUTRO_SORT_KEY_TYPE pivot_val = OUTRO_SORT_NAME(outro_sort_pivot)(begin, end);
+        if(lower != NULL && !(*lower < pivot_val))
+        {
+            begin = OUTRO_SORT_NAME(outro_sort_partition_equal)(begin, end, pivot_val);
+            continue;
+        }
+        int partitioned;
+        outro_sort_stats_begin(OUTRO_SORT_PHASE_PARTITION);
+        OUTRO_SORT_TYPE *ploc = OUTRO_SORT_NAME(outro_sort_partition)(begin, end, pivot_val, &partitioned);
+        outro_sort_stats_end();
+        if(partitioned && OUTRO_SORT_NAME(outro_sort_insertion_sort_bounded)(begin, ploc) && OUTRO_SORT_NAME(outro_sort_insertion_sort_bounded)(ploc, end))
+        {
+            return;
+        }
+
+        // The left part is bounded by whatever bounded the subarray, and the
+        // right part by the pivot.
+        OUTRO_SORT_KEY_TYPE const *small_lower = lower;
+        OUTRO_SORT_TYPE *small_begin = begin, *small_end = ploc;
+        if(ploc - begin > end - ploc)
+        {
+            small_begin = ploc;
+            small_end = end;
+            end = ploc;
+            small_lower = &pivot_val;
+        }
+        else
+        {
+            begin = ploc;
+        }
+
+        // A dispatched part must be joined before returning, so the larger
+        // part cannot be handled by the next iteration. The depth limit
+        // still bounds the number of nested calls.
+        struct OutroSortWorker worker;
+        struct OUTRO_SORT_NAME(OutroSortPart) small;
+        OUTRO_SORT_NAME(outro_sort_part)(&small, small_begin, small_end, depth, small_lower);
+        outro_sort_stats_begin(OUTRO_SORT_PHASE_DISPATCH);
+        int wstatus = outro_sort_dispatch(OUTRO_SORT_NAME(outro_sort_task), &small, NULL, small_end - small_begin, &worker);
+        outro_sort_stats_end();
+        outro_sort_stats_dispatched(wstatus);
+        if(wstatus < 0)
+        {
+            outro_sort_stats_enter();
+            OUTRO_SORT_NAME(outro_sort_loop)(small_begin, small_end, depth, small_lower);
+            outro_sort_stats_leave();
+        }
+        if(begin == ploc)
+        {
+            lower_val = pivot_val;
+            lower = &lower_val;
+        }
+        if(wstatus >= 0)
+        {
+            outro_sort_stats_enter();
+            OUTRO_SORT_NAME(outro_sort_loop)(begin, end, depth, lower);
+            outro_sort_stats_leave();
+            outro_sort_stats_begin(OUTRO_SORT_PHASE_DISPATCH);
+            outro_sort_join(&worker, wstatus);
+            outro_sort_stats_end();
+            return;
+        }
+    }
+}
+
+// Number of samples taken for each bucket by sample sort, and the minimum
+// number of elements in each bucket.
+#define OUTRO_SORT_SAMPLE_OVERSAMPLING 16
+#define OUTRO_SORT_SAMPLE_BUCKET_SIZE 65536U
+
+// Part of an array processed by one thread during sample sort.
+struct OUTRO_SORT_NAME(OutroSortSampleChunk)
+{
+    OUTRO_SORT_TYPE *src;
+    OUTRO_SORT_TYPE *dst;
+    size_t begin;
+    size_t end;
+
+    // Bucket of each element.
+    unsigned char *buckets;
+
+    // Keys separating the buckets, in ascending order.
+    OUTRO_SORT_KEY_TYPE const *splitters;
+    int num_buckets;
+
+    // Number of elements in each bucket. Overwritten with the positions to
+    // scatter elements to.
+    size_t *counts;
+};
+
+/******************************************************************************
+ * Find the buckets of the elements in a chunk, and count them.
+ *
+ * @param chunk_ Chunk.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_sample_count)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortSampleChunk) *chunk = chunk_;
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        // Elements equal to a splitter belong to the bucket after it.
+        OUTRO_SORT_KEY_TYPE key = OUTRO_SORT_NAME(outro_sort_key)(chunk->src + i);
+        int low = 0, high = chunk->num_buckets - 1;
+        while(low < high)
+        {
+            int mid = (low + high) / 2;
+            if(key < chunk->splitters[mid])
+            {
+                high = mid;
+            }
+            else
+            {
+                low = mid + 1;
+            }
+        }
+        chunk->buckets[i] = low;
+        ++chunk->counts[low];
+    }
+}
+
+/******************************************************************************
+ * Move the elements in a chunk to the positions computed from the counts of
+ * their buckets.
+ *
+ * @param chunk_ Chunk.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_sample_scatter)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortSampleChunk) *chunk = chunk_;
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        chunk->dst[chunk->counts[chunk->buckets[i]]++] = chunk->src[i];
+    }
+}
+
+/******************************************************************************
+ * Move the elements of a bucket back to the array, and sort them there.
+ *
+ * @param chunk_ Chunk, the range of which is that of the bucket.
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_sample_bucket)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortSampleChunk) *chunk = chunk_;
+    OUTRO_SORT_TYPE *begin = chunk->dst + chunk->begin, *end = chunk->dst + chunk->end;
+    memcpy(begin, chunk->src + chunk->begin, (end - begin) * sizeof *begin);
+    OUTRO_SORT_NAME(outro_sort_loop)(begin, end, outro_sort_depth_limit(end - begin), NULL);
+}
+
+/******************************************************************************
+ * Helper function to perform outro sort as an asynchronous sort or with a
+ * context.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_job)(void *begin, void *end)
+{
+    OUTRO_SORT_NAME(outro_sort)(begin, end);
+}
+
+/******************************************************************************
+ * Start sorting the elements of a subarray using outro sort without waiting
+ * for them to be sorted. See `outro_sort_submit_task`.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param job Handle to fill in, which must be passed to `outro_sort_wait`
+ *     exactly once.
+ *
+ * @return 0 if the sort was started, else -1.
+ *****************************************************************************/
+int
+OUTRO_SORT_NAME(outro_sort_submit)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end, struct OutroSortJob **job)
+{
+    return outro_sort_submit_task(OUTRO_SORT_NAME(outro_sort_job), begin, end, job);
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using outro sort with the settings, thread
+ * budget and scratch memory of a context instead of the global ones. See
+ * `outro_sort_call`.
+ *
+ * @param ctx Context.
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+void
+OUTRO_SORT_NAME(outro_sort_ctx)(struct OutroSortContext *ctx, OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    outro_sort_call(ctx, OUTRO_SORT_NAME(outro_sort_job), begin, end);
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using sample sort. Keys are sampled to find
+ * splitters which divide the elements into one bucket per available thread.
+ * Each thread finds the buckets of the elements in a chunk, and then moves
+ * them to a buffer. Finally, each thread moves one bucket back and sorts it
+ * using outro sort. Hence, every element is moved between threads only once.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *
+ * @return 0 if the subarray was sorted, else -1, in which case memory could
+ *     not be allocated, and the subarray is unchanged.
+ *****************************************************************************/
+int
+OUTRO_SORT_NAME(sample_sort)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    size_t size = end - begin;
+    int num_buckets = outro_sort_concurrency();
+    if(num_buckets > OUTRO_SORT_RUN_MAX)
+    {
+        num_buckets = OUTRO_SORT_RUN_MAX;
+    }
+    if((size_t)num_buckets > size / OUTRO_SORT_SAMPLE_BUCKET_SIZE)
+    {
+        num_buckets = size / OUTRO_SORT_SAMPLE_BUCKET_SIZE;
+    }
+    if(num_buckets < 2)
+    {
+        OUTRO_SORT_NAME(outro_sort_loop)(begin, end, outro_sort_depth_limit(size), NULL);
+        return 0;
+    }
+
+    // Pick the samples pseudorandomly, so that periodic patterns in the input
+    // do not skew the buckets.
+    OUTRO_SORT_TYPE samples[OUTRO_SORT_RUN_MAX * OUTRO_SORT_SAMPLE_OVERSAMPLING];
+    int num_samples = num_buckets * OUTRO_SORT_SAMPLE_OVERSAMPLING;
+    uint64_t state = size;
+    for(int i = 0; i < num_samples; ++i)
+    {
+        state = state * UINT64_C(6364136223846793005) + UINT64_C(1442695040888963407);
+        samples[i] = begin[(state >> 16) % size];
+    }
+    OUTRO_SORT_NAME(outro_sort_loop)(samples, samples + num_samples, outro_sort_depth_limit(num_samples), NULL);
+    OUTRO_SORT_KEY_TYPE splitters[OUTRO_SORT_RUN_MAX];
+    for(int i = 1; i < num_buckets; ++i)
+    {
+        splitters[i - 1] = OUTRO_SORT_NAME(outro_sort_key)(samples + i * OUTRO_SORT_SAMPLE_OVERSAMPLING);
+    }
+
+    OUTRO_SORT_TYPE *buffer = outro_sort_scratch_alloc(size * sizeof *buffer);
+    unsigned char *buckets = malloc(size);
+    size_t (*counts)[OUTRO_SORT_RUN_MAX] = calloc(num_buckets, sizeof *counts);
+    if(buffer == NULL || buckets == NULL || counts == NULL)
+    {
+        free(counts);
+        free(buckets);
+        outro_sort_scratch_free(buffer);
+        return -1;
+    }
+    struct OUTRO_SORT_NAME(OutroSortSampleChunk) chunks[OUTRO_SORT_RUN_MAX];
+    for(int i = 0; i < num_buckets; ++i)
+    {
+        chunks[i].src = begin;
+        chunks[i].dst = buffer;
+        chunks[i].begin = size * i / num_buckets;
+        chunks[i].end = size * (i + 1) / num_buckets;
+        chunks[i].buckets = buckets;
+        chunks[i].splitters = splitters;
+        chunks[i].num_buckets = num_buckets;
+        chunks[i].counts = counts[i];
+    }
+    outro_sort_run(OUTRO_SORT_NAME(outro_sort_sample_count), chunks, sizeof *chunks, num_buckets, size / num_buckets);
+
+    // Each chunk scatters the elements of a bucket after those of the same
+    // bucket from all preceding chunks.
+    size_t bounds[OUTRO_SORT_RUN_MAX + 1];
+    size_t position = 0;
+    for(int bucket = 0; bucket < num_buckets; ++bucket)
+    {
+        bounds[bucket] = position;
+        for(int i = 0; i < num_buckets; ++i)
+        {
+            size_t count = counts[i][bucket];
+            counts[i][bucket] = position;
+            position += count;
+        }
+    }
+    bounds[num_buckets] = position;
+    outro_sort_run(OUTRO_SORT_NAME(outro_sort_sample_scatter), chunks, sizeof *chunks, num_buckets, size / num_buckets);
+
+    for(int i = 0; i < num_buckets; ++i)
+    {
+        chunks[i].src = buffer;
+        chunks[i].dst = begin;
+        chunks[i].begin = bounds[i];
+        chunks[i].end = bounds[i + 1];
+    }
+    outro_sort_run(OUTRO_SORT_NAME(outro_sort_sample_bucket), chunks, sizeof *chunks, num_buckets, size / num_buckets);
+    free(counts);
+    free(buckets);
+    outro_sort_scratch_free(buffer);
+    return 0;
+}
+
+// Minimum length of a run merged by stable sort (shorter runs are extended
+// using insertion sort), minimum number of elements each thread should
+// process, and number of consecutive elements taken from one run after which
+// merging gallops through it.
+#define OUTRO_SORT_STABLE_MIN_RUN 32
+#define OUTRO_SORT_STABLE_CHUNK_SIZE 65536U
+#define OUTRO_SORT_STABLE_GALLOP 7
+
+// Part of an array processed by one thread during stable sort.
+struct OUTRO_SORT_NAME(OutroSortStableChunk)
+{
+    OUTRO_SORT_TYPE *src;
+    OUTRO_SORT_TYPE *dst;
+
+    // Range of the elements to find runs in, or of the merged elements to
+    // write.
+    size_t begin;
+    size_t end;
+
+    // Offsets of the first elements of the runs found, or of all runs being
+    // merged (followed by the size of the array).
+    size_t *runs;
+    size_t num_runs;
+};
+
+/******************************************************************************
+ * Find the runs in a chunk. Strictly descending runs are reversed (which
+ * keeps equal elements in order), and runs shorter than the minimum length
+ * are extended using insertion sort.
+ *
+ * @param chunk_
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_stable_runs)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortStableChunk) *chunk = chunk_;
+    OUTRO_SORT_TYPE *src = chunk->src;
+    chunk->num_runs = 0;
+    for(size_t i = chunk->begin, j; i < chunk->end; i = j)
+    {
+        chunk->runs[chunk->num_runs++] = i;
+        j = i + 1;
+        if(j < chunk->end && OUTRO_SORT_NAME(outro_sort_key)(src + j) < OUTRO_SORT_NAME(outro_sort_key)(src + i))
+        {
+            for(++j; j < chunk->end && OUTRO_SORT_NAME(outro_sort_key)(src + j) < OUTRO_SORT_NAME(outro_sort_key)(src + j - 1); ++j)
+            {
+            }
+            for(OUTRO_SORT_TYPE *left = src + i, *right = src + j - 1; left < right; ++left, --right)
+            {
+                OUTRO_SORT_NAME(outro_sort_swap)(left, right);
+            }
+        }
+        else
+        {
+            for(; j < chunk->end && !(OUTRO_SORT_NAME(outro_sort_key)(src + j) < OUTRO_SORT_NAME(outro_sort_key)(src + j - 1)); ++j)
+            {
+            }
+        }
+        if(j - i < OUTRO_SORT_STABLE_MIN_RUN)
+        {
+            j = chunk->end - i < OUTRO_SORT_STABLE_MIN_RUN ? chunk->end : i + OUTRO_SORT_STABLE_MIN_RUN;
+            OUTRO_SORT_NAME(insertion_sort)(src + i, src + j);
+        }
+    }
+}
+
+/******************************************************************************
+ * Find how many elements of the first of two sorted runs are among the given
+ * number of elements which merging them would output first. Elements of the
+ * first run precede equal elements of the second.
+ *
+ * @param a Pointer to the first element of the first run.
+ * @param a_size Number of elements in the first run.
+ * @param b Pointer to the first element of the second run.
+ * @param b_size Number of elements in the second run.
+ * @param k Number of elements output.
+ *
+ * @return Number of elements of the first run output.
+ *****************************************************************************/
+static size_t
+OUTRO_SORT_NAME(outro_sort_co_rank)(OUTRO_SORT_TYPE const *a, size_t a_size, OUTRO_SORT_TYPE const *b, size_t b_size, size_t k)
+{
+    size_t low = k > b_size ? k - b_size : 0, high = k < a_size ? k : a_size;
+    while(low < high)
+    {
+        size_t i = low + (high - low) / 2;
+        if(OUTRO_SORT_NAME(outro_sort_key)(b + k - i - 1) < OUTRO_SORT_NAME(outro_sort_key)(a + i))
+        {
+            high = i;
+        }
+        else
+        {
+            low = i + 1;
+        }
+    }
+    return low;
+}
+
+/******************************************************************************
+ * Find the first element of a sorted run which would be output after an
+ * element with the given key by a stable merge, searching from the beginning
+ * with exponentially increasing steps.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param key Key of the element.
+ * @param after Whether the element is in a later run than this one (so that
+ *     equal elements of this one precede it).
+ *
+ * @return Pointer to the element.
+ *****************************************************************************/
+static OUTRO_SORT_TYPE const *
+OUTRO_SORT_NAME(outro_sort_gallop)(OUTRO_SORT_TYPE const *begin, OUTRO_SORT_TYPE const *end, OUTRO_SORT_KEY_TYPE key, int after)
+{
+#define OUTRO_SORT_PRECEDES(elem) (after ? !(key < OUTRO_SORT_NAME(outro_sort_key)(elem)) : OUTRO_SORT_NAME(outro_sort_key)(elem) < key)
+    size_t size = end - begin, low = 0, high = 1;
+    for(; high <= size && OUTRO_SORT_PRECEDES(begin + high - 1); high *= 2)
+    {
+        low = high;
+    }
+    high = high < size ? high : size;
+    while(low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if(OUTRO_SORT_PRECEDES(begin + mid))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return begin + low;
+#undef OUTRO_SORT_PRECEDES
+}
+
+/******************************************************************************
+ * Merge two sorted runs. If one of them supplies many consecutive elements,
+ * the end of that streak is found by galloping, and it is copied at once.
+ *
+ * @param a Pointer to the first element of the first run.
+ * @param a_end Pointer to one past the last element of the first run.
+ * @param b Pointer to the first element of the second run.
+ * @param b_end Pointer to one past the last element of the second run.
+ * @param dst Pointer to the location to write the merged elements to.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_merge)(OUTRO_SORT_TYPE const *a, OUTRO_SORT_TYPE const *a_end, OUTRO_SORT_TYPE const *b, OUTRO_SORT_TYPE const *b_end, OUTRO_SORT_TYPE *dst)
+{
+    int a_wins = 0, b_wins = 0;
+    while(a < a_end && b < b_end)
+    {
+        OUTRO_SORT_TYPE const *stop;
+        if(OUTRO_SORT_NAME(outro_sort_key)(b) < OUTRO_SORT_NAME(outro_sort_key)(a))
+        {
+            *dst++ = *b++;
+            a_wins = 0;
+            if(++b_wins < OUTRO_SORT_STABLE_GALLOP)
+            {
+                continue;
+            }
+            stop = OUTRO_SORT_NAME(outro_sort_gallop)(b, b_end, OUTRO_SORT_NAME(outro_sort_key)(a), 0);
+            memcpy(dst, b, (stop - b) * sizeof *dst);
+            dst += stop - b;
+            b = stop;
+        }
+        else
+        {
+            *dst++ = *a++;
+            b_wins = 0;
+            if(++a_wins < OUTRO_SORT_STABLE_GALLOP)
+            {
+                continue;
+            }
+            stop = OUTRO_SORT_NAME(outro_sort_gallop)(a, a_end, OUTRO_SORT_NAME(outro_sort_key)(b), 1);
+            memcpy(dst, a, (stop - a) * sizeof *dst);
+            dst += stop - a;
+            a = stop;
+        }
+        a_wins = b_wins = 0;
+    }
+    memcpy(dst, a, (a_end - a) * sizeof *dst);
+    memcpy(dst + (a_end - a), b, (b_end - b) * sizeof *dst);
+}
+
+/******************************************************************************
+ * Merge pairs of adjacent runs, writing only the merged elements in a range.
+ * The parts of the runs which supply them are found using co-ranks, so the
+ * merge of two large runs can be split across threads.
+ *
+ * @param chunk_
+ * @param unused
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_sort_stable_merge)(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct OUTRO_SORT_NAME(OutroSortStableChunk) *chunk = chunk_;
+    size_t const *runs = chunk->runs;
+    size_t num_runs = chunk->num_runs, num_pairs = (num_runs + 1) / 2;
+
+    // Find the first pair which ends after the beginning of the range.
+    size_t pair = 0;
+    for(size_t high = num_pairs; pair < high;)
+    {
+        size_t mid = pair + (high - pair) / 2;
+        if(runs[2 * mid + 2 < num_runs ? 2 * mid + 2 : num_runs] <= chunk->begin)
+        {
+            pair = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    for(; pair < num_pairs && runs[2 * pair] < chunk->end; ++pair)
+    {
+        size_t lo = runs[2 * pair];
+        size_t mid = runs[2 * pair + 1 < num_runs ? 2 * pair + 1 : num_runs];
+        size_t hi = runs[2 * pair + 2 < num_runs ? 2 * pair + 2 : num_runs];
+        size_t k_begin = (chunk->begin > lo ? chunk->begin : lo) - lo;
+        size_t k_end = (chunk->end < hi ? chunk->end : hi) - lo;
+        OUTRO_SORT_TYPE const *a = chunk->src + lo, *b = chunk->src + mid;
+        size_t i_begin = OUTRO_SORT_NAME(outro_sort_co_rank)(a, mid - lo, b, hi - mid, k_begin);
+        size_t i_end = OUTRO_SORT_NAME(outro_sort_co_rank)(a, mid - lo, b, hi - mid, k_end);
+        OUTRO_SORT_NAME(outro_sort_merge)(a + i_begin, a + i_end, b + k_begin - i_begin, b + k_end - i_end, chunk->dst + lo + k_begin);
+    }
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray without changing the order of elements with
+ * equal keys, using natural merge sort. Runs already present in the subarray
+ * are found (by multiple threads, each searching a chunk), and adjacent runs
+ * are merged pairwise, alternating between the subarray and a buffer. Every
+ * thread writes an equal part of the output of each pass, even if it lies in
+ * a single merge.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *
+ * @return 0 if the subarray was sorted, else -1, in which case memory could
+ *     not be allocated, and the subarray is unchanged.
+ *****************************************************************************/
+int
+OUTRO_SORT_NAME(stable_sort)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    size_t size = end - begin;
+    if(size < 2)
+    {
+        return 0;
+    }
+    int num_chunks = outro_sort_concurrency();
+    if(num_chunks > OUTRO_SORT_RUN_MAX)
+    {
+        num_chunks = OUTRO_SORT_RUN_MAX;
+    }
+    if((size_t)num_chunks > size / OUTRO_SORT_STABLE_CHUNK_SIZE)
+    {
+        num_chunks = size / OUTRO_SORT_STABLE_CHUNK_SIZE > 0 ? size / OUTRO_SORT_STABLE_CHUNK_SIZE : 1;
+    }
+
+    // Every run in a chunk but the last is at least as long as the minimum.
+    OUTRO_SORT_TYPE *buffer = outro_sort_scratch_alloc(size * sizeof *buffer);
+    size_t *runs = malloc((size / OUTRO_SORT_STABLE_MIN_RUN + num_chunks + 1) * sizeof *runs);
+    if(buffer == NULL || runs == NULL)
+    {
+        free(runs);
+        outro_sort_scratch_free(buffer);
+        return -1;
+    }
+
+    struct OUTRO_SORT_NAME(OutroSortStableChunk) chunks[OUTRO_SORT_RUN_MAX];
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].src = begin;
+        chunks[i].begin = size * i / num_chunks;
+        chunks[i].end = size * (i + 1) / num_chunks;
+        chunks[i].runs = runs + chunks[i].begin / OUTRO_SORT_STABLE_MIN_RUN + i;
+    }
+    outro_sort_run(OUTRO_SORT_NAME(outro_sort_stable_runs), chunks, sizeof *chunks, num_chunks, size / num_chunks);
+    size_t num_runs = 0;
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        memmove(runs + num_runs, chunks[i].runs, chunks[i].num_runs * sizeof *runs);
+        num_runs += chunks[i].num_runs;
+    }
+    runs[num_runs] = size;
+
+    OUTRO_SORT_TYPE *src = begin, *dst = buffer;
+    while(num_runs > 1)
+    {
+        for(int i = 0; i < num_chunks; ++i)
+        {
+            chunks[i].src = src;
+            chunks[i].dst = dst;
+            chunks[i].runs = runs;
+            chunks[i].num_runs = num_runs;
+        }
+        outro_sort_run(OUTRO_SORT_NAME(outro_sort_stable_merge), chunks, sizeof *chunks, num_chunks, size / num_chunks);
+        size_t num_merged = 0;
+        for(size_t i = 0; i < num_runs; i += 2)
+        {
+            runs[num_merged++] = runs[i];
+        }
+        runs[num_merged] = size;
+        num_runs = num_merged;
+        OUTRO_SORT_TYPE *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if(src != begin)
+    {
+        memcpy(begin, src, size * sizeof *begin);
+    }
+    free(runs);
+    outro_sort_scratch_free(buffer);
+    return 0;
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray using outro sort. This is a hybrid algorithm
+ * which executes a sorting network or insertion sort on small subarrays and
+ * quick sort on large subarrays, falling back to heap sort if partitioning
+ * goes badly. If the keys support it, very large subarrays are sorted using
+ * radix sort instead. If sample sort was selected using
+ * `outro_sort_configure_mode`, it distributes the elements first.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+void
+OUTRO_SORT_NAME(outro_sort)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *end)
+{
+    if(outro_sort_settings()->mode == OUTRO_SORT_MODE_SAMPLE && OUTRO_SORT_NAME(sample_sort)(begin, end) == 0)
+    {
+        return;
+    }
+    OUTRO_SORT_NAME(outro_sort_loop)(begin, end, outro_sort_depth_limit(end - begin), NULL);
+}
+
+/******************************************************************************
+ * Sort the elements of a subarray which would be in a prefix of it if it were
+ * sorted. Parts of partitions which are entirely in the prefix are sorted
+ * using outro sort (the smaller of them dispatched, like in `outro_sort_loop`)
+ * while the part containing the end of the prefix is partitioned further.
+ * Parts entirely beyond the prefix are not touched again.
+ *
+ * @param begin Pointer to the first element.
+ * @param middle Pointer to one past the last element of the prefix.
+ * @param end Pointer to one past the last element.
+ * @param depth Number of times the subarray may still be partitioned.
+ * @param lower Pointer to a key not greater than any key in the subarray, or
+ *     `NULL`.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_partial_sort_loop)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *middle, OUTRO_SORT_TYPE *end, int depth, OUTRO_SORT_KEY_TYPE const *lower)
+{
+    OUTRO_SORT_KEY_TYPE lower_val;
+    for(;;)
+    {
+        if(middle <= begin)
+        {
+            return;
+        }
+        if(end <= middle || (size_t)(end - begin) <= outro_sort_settings()->leaf_size)
+        {
+            OUTRO_SORT_NAME(outro_sort_loop)(begin, end, depth, lower);
+            return;
+        }
+        if(depth-- == 0)
+        {
+            OUTRO_SORT_NAME(outro_sort_heap_sort)(begin, end);
+            return;
+        }
+        OUTRO_SORT_KEY_TYPE pivot_val = OUTRO_SORT_NAME(outro_sort_pivot)(begin, end);
+        if(lower != NULL && !(*lower < pivot_val))
+        {
+            begin = OUTRO_SORT_NAME(outro_sort_partition_equal)(begin, end, pivot_val);
+            continue;
+        }
+        int partitioned;
+        outro_sort_stats_begin(OUTRO_SORT_PHASE_PARTITION);
+        OUTRO_SORT_TYPE *ploc = OUTRO_SORT_NAME(outro_sort_partition)(begin, end, pivot_val, &partitioned);
+        outro_sort_stats_end();
+        if(middle < ploc)
+        {
+            end = ploc;
+            continue;
+        }
+
+        // The left part is in the prefix. Sort it while the right part is
+        // partitioned further.
+        struct OutroSortWorker worker;
+        struct OUTRO_SORT_NAME(OutroSortPart) prefix;
+        OUTRO_SORT_NAME(outro_sort_part)(&prefix, begin, ploc, depth, lower);
+        outro_sort_stats_begin(OUTRO_SORT_PHASE_DISPATCH);
+        int wstatus = outro_sort_dispatch(OUTRO_SORT_NAME(outro_sort_task), &prefix, NULL, ploc - begin, &worker);
+        outro_sort_stats_end();
+        outro_sort_stats_dispatched(wstatus);
+        if(wstatus < 0)
+        {
+            outro_sort_stats_enter();
+            OUTRO_SORT_NAME(outro_sort_loop)(begin, ploc, depth, lower);
+            outro_sort_stats_leave();
+        }
+        lower_val = pivot_val;
+        lower = &lower_val;
+        begin = ploc;
+        if(wstatus >= 0)
+        {
+            outro_sort_stats_enter();
+            OUTRO_SORT_NAME(outro_partial_sort_loop)(begin, middle, end, depth, lower);
+            outro_sort_stats_leave();
+            outro_sort_stats_begin(OUTRO_SORT_PHASE_DISPATCH);
+            outro_sort_join(&worker, wstatus);
+            outro_sort_stats_end();
+            return;
+        }
+    }
+}
+
+/******************************************************************************
+ * Rearrange the elements of a subarray so that the least elements are sorted
+ * at its beginning. The order of the remaining elements is unspecified.
+ *
+ * @param begin Pointer to the first element.
+ * @param middle Pointer to one past the last element which should be sorted.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+void
+OUTRO_SORT_NAME(outro_partial_sort)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *middle, OUTRO_SORT_TYPE *end)
+{
+    OUTRO_SORT_NAME(outro_partial_sort_loop)(begin, middle, end, outro_sort_depth_limit(end - begin), NULL);
+}
+
+/******************************************************************************
+ * Rearrange the elements of a subarray so that the element at the given
+ * position is the one which would be there if the subarray were sorted, no
+ * element before it is greater, and no element after it is less. Only the
+ * part of each partition containing that position is partitioned further.
+ *
+ * @param begin Pointer to the first element.
+ * @param nth Pointer to the position.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+void
+OUTRO_SORT_NAME(outro_nth_element)(OUTRO_SORT_TYPE *begin, OUTRO_SORT_TYPE *nth, OUTRO_SORT_TYPE *end)
+{
+    OUTRO_SORT_KEY_TYPE const *lower = NULL;
+    OUTRO_SORT_KEY_TYPE lower_val;
+    for(int depth = outro_sort_depth_limit(end - begin); nth < end;)
+    {
+        if((size_t)(end - begin) <= outro_sort_settings()->leaf_size)
+        {
+            OUTRO_SORT_NAME(outro_sort_loop)(begin, end, 0, NULL);
+            return;
+        }
+        if(depth-- == 0)
+        {
+            OUTRO_SORT_NAME(outro_sort_heap_sort)(begin, end);
+            return;
+        }
+        OUTRO_SORT_KEY_TYPE pivot_val = OUTRO_SORT_NAME(outro_sort_pivot)(begin, end);
+        if(lower != NULL && !(*lower < pivot_val))
+        {
+            // The elements equal to the pivot are where they would be if the
+            // subarray were sorted.
+            begin = OUTRO_SORT_NAME(outro_sort_partition_equal)(begin, end, pivot_val);
+            if(nth < begin)
+            {
+                return;
+            }
+            continue;
+        }
+        int partitioned;
+        OUTRO_SORT_TYPE *ploc = OUTRO_SORT_NAME(outro_sort_partition)(begin, end, pivot_val, &partitioned);
+        if(nth < ploc)
+        {
+            end = ploc;
+        }
+        else
+        {
+            begin = ploc;
+            lower_val = pivot_val;
+            lower = &lower_val;
+        }
+    }
+}
+
+/******************************************************************************
+ * Prepare to select the least elements of a stream.
+ *
+ * @param top_k State to initialise.
+ * @param k Number of elements to select.
+ *
+ * @return 0 if successful, else -1, in which case memory could not be
+ *     allocated.
+ *****************************************************************************/
+int
+OUTRO_SORT_NAME(outro_top_k_init)(struct OUTRO_SORT_NAME(OutroSortTopK) *top_k, size_t k)
+{
+    top_k->k = k;
+    top_k->size = 0;
+    top_k->capacity = 2 * k + 16;
+    top_k->pruned = 0;
+    top_k->buffer = malloc(top_k->capacity * sizeof *top_k->buffer);
+    return top_k->buffer == NULL ? -1 : 0;
+}
+
+/******************************************************************************
+ * Keep only the least `k` elements in the buffer.
+ *
+ * @param top_k State.
+ *****************************************************************************/
+static void
+OUTRO_SORT_NAME(outro_top_k_prune)(struct OUTRO_SORT_NAME(OutroSortTopK) *top_k)
+{
+    if(top_k->size > top_k->k)
+    {
+        OUTRO_SORT_NAME(outro_nth_element)(top_k->buffer, top_k->buffer + top_k->k - 1, top_k->buffer + top_k->size);
+        top_k->size = top_k->k;
+        top_k->pruned = 1;
+    }
+}
+
+/******************************************************************************
+ * Add a batch of elements to a stream. After the buffer has been pruned once,
+ * elements not less than the greatest of the least `k` elements are rejected
+ * without being copied. When the buffer is full, it is pruned using
+ * `outro_nth_element`, so each element costs amortised constant time.
+ *
+ * @param top_k State.
+ * @param begin Pointer to the first element of the batch.
+ * @param end Pointer to one past the last element of the batch.
+ *****************************************************************************/
+void
+OUTRO_SORT_NAME(outro_top_k_push)(struct OUTRO_SORT_NAME(OutroSortTopK) *top_k, OUTRO_SORT_TYPE const *begin, OUTRO_SORT_TYPE const *end)
+{
+    if(top_k->k == 0)
+    {
+        return;
+    }
+    OUTRO_SORT_TYPE *threshold = top_k->buffer + top_k->k - 1;
+    for(; begin < end; ++begin)
+    {
+        if(top_k->pruned && !(OUTRO_SORT_NAME(outro_sort_key)(begin) < OUTRO_SORT_NAME(outro_sort_key)(threshold)))
+        {
+            continue;
+        }
+        if(top_k->size == top_k->capacity)
+        {
+            OUTRO_SORT_NAME(outro_top_k_prune)(top_k);
+            if(!(OUTRO_SORT_NAME(outro_sort_key)(begin) < OUTRO_SORT_NAME(outro_sort_key)(threshold)))
+            {
+                continue;
+            }
+        }
+        top_k->buffer[top_k->size++] = *begin;
+    }
+}
+
+/******************************************************************************
+ * Sort the least elements of the stream so far. More elements may be added
+ * afterwards.
+ *
+ * @param top_k State.
+ *
+ * @return Number of elements selected (`k`, unless the stream is shorter).
+ *     They are stored in ascending order at the beginning of the buffer.
+ *****************************************************************************/
+size_t
+OUTRO_SORT_NAME(outro_top_k_result)(struct OUTRO_SORT_NAME(OutroSortTopK) *top_k)
+{
+    if(top_k->k == 0)
+    {
+        return 0;
+    }
+    OUTRO_SORT_NAME(outro_top_k_prune)(top_k);
+    OUTRO_SORT_NAME(outro_sort)(top_k->buffer, top_k->buffer + top_k->size);
+    return top_k->size;
+}
+
+/******************************************************************************
+ * Release the memory used to select the least elements of a stream.
+ *
+ * @param top_k State.
+ *****************************************************************************/
+void
+OUTRO_SORT_NAME(outro_top_k_destroy)(struct OUTRO_SORT_NAME(OutroSortTopK) *top_k)
+{
+    free(top_k->buffer);
+    top_k->buffer = NULL;
+}
+
+#undef OUTRO_SORT_BLOCK_SIZE
+#undef OUTRO_SORT_PARTITION_CHUNK_SIZE
+#undef OUTRO_SORT_SAMPLE_OVERSAMPLING
+#undef OUTRO_SORT_SAMPLE_BUCKET_SIZE
+#undef OUTRO_SORT_STABLE_MIN_RUN
+#undef OUTRO_SORT_STABLE_CHUNK_SIZE
+#undef OUTRO_SORT_STABLE_GALLOP
+#undef OUTRO_SORT_CONCAT_
+#undef OUTRO_SORT_CONCAT
+#undef OUTRO_SORT_NAME
+#undef OUTRO_SORT_TYPE
+#undef OUTRO_SORT_SUFFIX
+#undef OUTRO_SORT_KEY_TYPE
+#undef OUTRO_SORT_KEY_OFFSET
+#undef OUTRO_SORT_RADIX_TYPE
+#undef OUTRO_SORT_RADIX_KEY
+#undef OUTRO_SORT_PARTITION_KERNEL
+#undef OUTRO_SORT_NETWORK_KERNEL
@@ -0,0 +1,1122 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "outro_sort.h"
+#include "pool.h"
+
+#ifdef MULTITHREADED_OUTRO_SORT
+typedef atomic_uint_least64_t CallCounter;
+#define CALL_COUNTER_INIT(counter) atomic_init(&(counter), 0)
+#define CALL_COUNTER_LOAD(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#define CALL_COUNTER_ADD(counter) atomic_fetch_add_explicit(&(counter), 1, memory_order_relaxed)
+#define THREAD_LOCAL _Thread_local
+#else
+typedef uint_least64_t CallCounter;
+#define CALL_COUNTER_INIT(counter) ((counter) = 0)
+#define CALL_COUNTER_LOAD(counter) (counter)
+#define CALL_COUNTER_ADD(counter) (++(counter))
+#define THREAD_LOCAL
+#endif
+
+// State of a sort with a context, shared by all threads working on it.
+struct OutroSortCall
+{
+    struct OutroSortContext *ctx;
+#ifdef MULTITHREADED_OUTRO_SORT
+    // Number of threads which may sort simultaneously, less those already
+    // sorting (or tasks already queued), including the calling thread.
+    atomic_int threads;
+
+    atomic_bool scratch_used;
+#else
+    bool scratch_used;
+#endif
+    CallCounter queued;
+    CallCounter spawned;
+    CallCounter inlined;
+};
+
+// Sort with a context the current thread is working on, if any.
+static THREAD_LOCAL struct OutroSortCall *current_call;
+
+// Asynchronous sort. Its root task sorts the whole array.
+struct OutroSortJob
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    struct OutroSortTask task;
+    atomic_bool cancelled;
+
+    // Whether any part of the array was skipped because of cancellation.
+    atomic_bool interrupted;
+
+    // Whether the job is waiting in the queue of the pool, and the next job
+    // in it.
+    bool queued;
+    struct OutroSortJob *next;
+
+    // Whether the job has its own thread (if the pool was not running when it
+    // was submitted).
+    bool threaded;
+    thrd_t thr;
+#else
+    int unused;
+#endif
+};
+
+#ifdef MULTITHREADED_OUTRO_SORT
+static atomic_int available_threads = 32;
+
+// Maximum number of tasks a deque can hold. If it is full, the thread trying
+// to fork a task must execute it itself.
+#define DEQUE_CAPACITY 64
+
+// Double-ended queue of tasks. Its owner pushes and pops tasks at the tail,
+// while other threads steal them from the head.
+struct Deque
+{
+    mtx_t lock;
+    struct OutroSortTask *tasks[DEQUE_CAPACITY];
+    int head;
+    int count;
+};
+
+static struct
+{
+    bool active;
+    int num_workers;
+    thrd_t *workers;
+
+    // One deque per worker, followed by one shared by all threads which are
+    // not workers.
+    struct Deque *deques;
+
+    // Number of tasks in all deques.
+    atomic_int queued;
+    atomic_bool stopping;
+
+    // Asynchronous sorts which no thread has started yet, oldest first.
+    struct OutroSortJob *jobs_head;
+    struct OutroSortJob *jobs_tail;
+
+    // Idle workers sleep on this condition variable, and threads waiting for
+    // asynchronous sorts on the other.
+    mtx_t lock;
+    cnd_t wake;
+    cnd_t finished;
+} pool;
+
+// Index of the deque owned by the current thread, if it is a worker.
+static _Thread_local int deque_index = -1;
+
+// Asynchronous sort the current thread is working on, if any.
+static _Thread_local struct OutroSortJob *current_job;
+
+/******************************************************************************
+ * Obtain the deque the current thread should push tasks to.
+ *
+ * @return Index of the deque.
+ *****************************************************************************/
+static int
+pool_own_deque(void)
+{
+    return deque_index >= 0 ? deque_index : pool.num_workers;
+}
+
+/******************************************************************************
+ * Add a task at the tail of a deque.
+ *
+ * @param deque
+ * @param task
+ *
+ * @return true if the task was added, else false.
+ *****************************************************************************/
+static bool
+deque_push(struct Deque *deque, struct OutroSortTask *task)
+{
+    mtx_lock(&deque->lock);
+    bool pushed = deque->count < DEQUE_CAPACITY;
+    if(pushed)
+    {
+        deque->tasks[(deque->head + deque->count++) % DEQUE_CAPACITY] = task;
+    }
+    mtx_unlock(&deque->lock);
+    return pushed;
+}
+
+/******************************************************************************
+ * Remove a task from the tail of a deque, but only if it is the given one.
+ *
+ * @param deque
+ * @param task
+ *
+ * @return true if the task was removed, else false.
+ *****************************************************************************/
+static bool
+deque_pop(struct Deque *deque, struct OutroSortTask *task)
+{
+    mtx_lock(&deque->lock);
+    bool popped = deque->count > 0 && deque->tasks[(deque->head + deque->count - 1) % DEQUE_CAPACITY] == task;
+    if(popped)
+    {
+        --deque->count;
+    }
+    mtx_unlock(&deque->lock);
+    return popped;
+}
+
+/******************************************************************************
+ * Remove the task at the head of a deque.
+ *
+ * @param deque
+ *
+ * @return Task if the deque was not empty, else `NULL`.
+ *****************************************************************************/
+static struct OutroSortTask *
+deque_steal(struct Deque *deque)
+{
+    struct OutroSortTask *task = NULL;
+    mtx_lock(&deque->lock);
+    if(deque->count > 0)
+    {
+        task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % DEQUE_CAPACITY;
+        --deque->count;
+    }
+    mtx_unlock(&deque->lock);
+    return task;
+}
+
+/******************************************************************************
+ * Find a task in any deque, starting with the given one.
+ *
+ * @param first Index of the deque to look in first.
+ * @param count Number of deques to look in.
+ *
+ * @return Task if one was found, else `NULL`.
+ *****************************************************************************/
+static struct OutroSortTask *
+pool_steal(int first, int count)
+{
+    if(atomic_load(&pool.queued) <= 0)
+    {
+        return NULL;
+    }
+    for(int i = 0; i < count; ++i)
+    {
+        struct OutroSortTask *task = deque_steal(pool.deques + (first + i) % (pool.num_workers + 1));
+        if(task != NULL)
+        {
+            atomic_fetch_sub(&pool.queued, 1);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * Execute a task as part of the sorts it belongs to (if any), and mark it as
+ * done.
+ *
+ * @param task
+ *****************************************************************************/
+static void
+pool_run(struct OutroSortTask *task)
+{
+    struct OutroSortJob *job = current_job;
+    struct OutroSortCall *call = current_call;
+    current_job = task->job;
+    current_call = task->call;
+    task->func(task->begin, task->end);
+    current_job = job;
+    current_call = call;
+    atomic_store(&task->done, 1);
+}
+
+/******************************************************************************
+ * Remove an asynchronous sort from the queue. The lock of the pool must be
+ * held.
+ *
+ * @param job
+ *****************************************************************************/
+static void
+pool_unqueue(struct OutroSortJob *job)
+{
+    struct OutroSortJob **link = &pool.jobs_head, *prev = NULL;
+    for(; *link != job; link = &(*link)->next)
+    {
+        prev = *link;
+    }
+    *link = job->next;
+    if(pool.jobs_tail == job)
+    {
+        pool.jobs_tail = prev;
+    }
+    job->queued = false;
+    atomic_fetch_sub(&pool.queued, 1);
+}
+
+/******************************************************************************
+ * Start the oldest asynchronous sort no thread has started yet, and execute
+ * its root task.
+ *
+ * @return true if there was such a sort, else false.
+ *****************************************************************************/
+static bool
+pool_run_job(void)
+{
+    mtx_lock(&pool.lock);
+    struct OutroSortJob *job = pool.jobs_head;
+    if(job != NULL)
+    {
+        pool_unqueue(job);
+    }
+    mtx_unlock(&pool.lock);
+    if(job == NULL)
+    {
+        return false;
+    }
+    pool_run(&job->task);
+    mtx_lock(&pool.lock);
+    cnd_broadcast(&pool.finished);
+    mtx_unlock(&pool.lock);
+    return true;
+}
+
+/******************************************************************************
+ * Main loop of a worker: execute tasks from its own deque, else start an
+ * asynchronous sort, else execute tasks from any other deque, sleeping when
+ * there are none. Starting new sorts before helping with others means that
+ * each sort submitted gets a worker as soon as one runs out of its own work,
+ * even while a large sort keeps the other deques full.
+ *
+ * @param deque Deque owned by this worker.
+ *
+ * @return Ignored.
+ *****************************************************************************/
+static int
+pool_worker(void *deque)
+{
+    deque_index = (struct Deque *)deque - pool.deques;
+    while(!atomic_load(&pool.stopping))
+    {
+        struct OutroSortTask *task = pool_steal(deque_index, 1);
+        if(task == NULL)
+        {
+            if(pool_run_job())
+            {
+                continue;
+            }
+            task = pool_steal(deque_index, pool.num_workers + 1);
+        }
+        if(task != NULL)
+        {
+            pool_run(task);
+            continue;
+        }
+        mtx_lock(&pool.lock);
+        while(atomic_load(&pool.queued) <= 0 && !atomic_load(&pool.stopping))
+        {
+            cnd_wait(&pool.wake, &pool.lock);
+        }
+        mtx_unlock(&pool.lock);
+    }
+    return EXIT_SUCCESS;
+}
+
+/******************************************************************************
+ * Check whether tasks can be forked.
+ *
+ * @return 1 if the pool is running, else 0.
+ *****************************************************************************/
+int
+outro_sort_pool_active(void)
+{
+    return pool.active;
+}
+
+/******************************************************************************
+ * Make a task available to the workers. It must be joined by the calling
+ * thread.
+ *
+ * @param task Task. Its function and sort range must be set.
+ *
+ * @return 0 if the task was queued, else -1, in which case the calling thread
+ *     must execute it.
+ *****************************************************************************/
+int
+outro_sort_pool_fork(struct OutroSortTask *task)
+{
+    atomic_init(&task->done, 0);
+    atomic_fetch_add(&pool.queued, 1);
+    if(!deque_push(pool.deques + pool_own_deque(), task))
+    {
+        atomic_fetch_sub(&pool.queued, 1);
+        return -1;
+    }
+    mtx_lock(&pool.lock);
+    cnd_signal(&pool.wake);
+    mtx_unlock(&pool.lock);
+    return 0;
+}
+
+/******************************************************************************
+ * Wait for a forked task to complete. If no other thread has started it yet,
+ * execute it. Otherwise, execute other tasks while waiting.
+ *
+ * @param task
+ *****************************************************************************/
+void
+outro_sort_pool_join(struct OutroSortTask *task)
+{
+    int own = pool_own_deque();
+    if(deque_pop(pool.deques + own, task))
+    {
+        atomic_fetch_sub(&pool.queued, 1);
+        pool_run(task);
+        return;
+    }
+    while(!atomic_load(&task->done))
+    {
+        struct OutroSortTask *other = pool_steal(own, pool.num_workers + 1);
+        if(other != NULL)
+        {
+            pool_run(other);
+        }
+        else
+        {
+            thrd_yield();
+        }
+    }
+}
+
+/******************************************************************************
+ * Stop the first few workers and release the resources of the pool.
+ *
+ * @param num_started Number of workers which were started.
+ *****************************************************************************/
+static void
+pool_destroy(int num_started)
+{
+    // Asynchronous sorts still queued are run now, since the lock they would
+    // otherwise use when waited for is about to be destroyed.
+    while(pool_run_job())
+    {
+    }
+    mtx_lock(&pool.lock);
+    atomic_store(&pool.stopping, true);
+    cnd_broadcast(&pool.wake);
+    mtx_unlock(&pool.lock);
+    for(int i = 0; i < num_started; ++i)
+    {
+        thrd_join(pool.workers[i], NULL);
+    }
+    for(int i = 0; i <= pool.num_workers; ++i)
+    {
+        mtx_destroy(&pool.deques[i].lock);
+    }
+    cnd_destroy(&pool.finished);
+    cnd_destroy(&pool.wake);
+    mtx_destroy(&pool.lock);
+    free(pool.deques);
+    free(pool.workers);
+    pool.active = false;
+}
+
+/******************************************************************************
+ * Reserve a thread from a budget, unless only the calling thread is left.
+ *
+ * @param budget Number of threads which may still be used, including the
+ *     calling thread.
+ *
+ * @return true if a thread was reserved, else false.
+ *****************************************************************************/
+static bool
+budget_reserve(atomic_int *budget)
+{
+    int available = atomic_load_explicit(budget, memory_order_relaxed);
+    while(available > 1)
+    {
+        if(atomic_compare_exchange_weak_explicit(budget, &available, available - 1, memory_order_relaxed, memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/******************************************************************************
+ * Reserve a thread from the budget of a sort with a context.
+ *
+ * @param call Sort, or `NULL`, which has no budget of its own.
+ *
+ * @return true if a thread was reserved, else false.
+ *****************************************************************************/
+static bool
+call_reserve(struct OutroSortCall *call)
+{
+    return call == NULL || budget_reserve(&call->threads);
+}
+
+/******************************************************************************
+ * Return a thread to the budget of a sort with a context.
+ *
+ * @param call Sort, or `NULL`.
+ *****************************************************************************/
+static void
+call_release(struct OutroSortCall *call)
+{
+    if(call != NULL)
+    {
+        atomic_fetch_add_explicit(&call->threads, 1, memory_order_relaxed);
+    }
+}
+#endif
+
+/******************************************************************************
+ * Configure outro sort.
+ *
+ * @param available_threads_ Maximum number of simultaneously active threads.
+ *     This need not be equal to the number of logical processors; typically,
+ *     using a much larger number will significantly improve performance. If
+ *     multithreading is not supported or the thread pool is running, this
+ *     argument is ignored.
+ * @param multithreading_threshold_ Minimum size of a subarray for which
+ *     multithreading should be used. If multithreading is not supported, this
+ *     argument is ignored.
+ *****************************************************************************/
+void
+outro_sort_configure(int available_threads_, size_t multithreading_threshold_)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    available_threads = available_threads_;
+    outro_sort_config.max_threads = available_threads_;
+    outro_sort_config.multithreading_threshold = multithreading_threshold_;
+#else
+    (void)available_threads_;
+    (void)multithreading_threshold_;
+#endif
+}
+
+#ifdef MULTITHREADED_OUTRO_SORT
+/******************************************************************************
+ * Helper function to perform a task in a separate thread.
+ *
+ * @param task_ Task describing the sort range.
+ *
+ * @return Ignored.
+ *****************************************************************************/
+static int
+outro_sort_exec(void *task_)
+{
+    struct OutroSortTask *task = task_;
+    current_job = task->job;
+    current_call = task->call;
+    task->func(task->begin, task->end);
+    thrd_exit(EXIT_SUCCESS);
+}
+#endif
+
+/******************************************************************************
+ * Helper function to sort a subarray in a separate thread (if possible). If
+ * the thread pool is running, the subarray is queued for its workers.
+ * Otherwise, a new thread is started. Threads (or queued subarrays) are
+ * reserved from the budget of the sort with a context the calling thread is
+ * working on, and new threads also from the global budget.
+ *
+ * @param func Sort function.
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param size Number of elements.
+ * @param worker Handle to fill in.
+ *
+ * @return 1 if the subarray was queued, 0 if a thread was started, else -1,
+ *     in which case the caller must sort the subarray itself.
+ *****************************************************************************/
+int
+outro_sort_dispatch(void (*func)(void *, void *), void *begin, void *end, size_t size, struct OutroSortWorker *worker)
+{
+    struct OutroSortCall *call = current_call;
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(size >= outro_sort_settings()->multithreading_threshold)
+    {
+        worker->task.func = func;
+        worker->task.begin = begin;
+        worker->task.end = end;
+        worker->task.job = current_job;
+        worker->task.call = call;
+        if(outro_sort_pool_active())
+        {
+            if(call_reserve(call))
+            {
+                if(outro_sort_pool_fork(&worker->task) == 0)
+                {
+                    if(call != NULL)
+                    {
+                        CALL_COUNTER_ADD(call->queued);
+                    }
+                    return 1;
+                }
+                call_release(call);
+            }
+        }
+        else if(budget_reserve(&available_threads))
+        {
+            if(call_reserve(call))
+            {
+                if(thrd_create(&worker->thr, outro_sort_exec, &worker->task) == thrd_success)
+                {
+                    if(call != NULL)
+                    {
+                        CALL_COUNTER_ADD(call->spawned);
+                    }
+                    return 0;
+                }
+                call_release(call);
+            }
+            ++available_threads;
+        }
+    }
+#else
+    (void)func;
+    (void)begin;
+    (void)end;
+    (void)size;
+    (void)worker;
+#endif
+    if(call != NULL)
+    {
+        CALL_COUNTER_ADD(call->inlined);
+    }
+    return -1;
+}
+
+/******************************************************************************
+ * Wait for a subarray passed to `outro_sort_dispatch` to be sorted.
+ *
+ * @param worker Handle filled in by `outro_sort_dispatch`.
+ * @param wstatus Value returned by `outro_sort_dispatch`.
+ *****************************************************************************/
+void
+outro_sort_join(struct OutroSortWorker *worker, int wstatus)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(wstatus == 1)
+    {
+        outro_sort_pool_join(&worker->task);
+        call_release(worker->task.call);
+    }
+    else if(wstatus == 0)
+    {
+        thrd_join(worker->thr, NULL);
+        call_release(worker->task.call);
+        ++available_threads;
+    }
+#else
+    (void)worker;
+    (void)wstatus;
+#endif
+}
+
+/******************************************************************************
+ * Call a function on each item of an array, using separate threads (if
+ * possible). The calling thread processes the first item. Returns after all
+ * items have been processed.
+ *
+ * @param func Function, which receives a pointer to an item and `NULL`.
+ * @param items
+ * @param item_size Size of an item in bytes.
+ * @param num_items Number of items. At most `OUTRO_SORT_RUN_MAX`.
+ * @param size Number of elements each item refers to, which decides whether
+ *     it is worth using multithreading.
+ *****************************************************************************/
+void
+outro_sort_run(void (*func)(void *, void *), void *items, size_t item_size, int num_items, size_t size)
+{
+    struct OutroSortWorker workers[OUTRO_SORT_RUN_MAX];
+    int wstatus[OUTRO_SORT_RUN_MAX];
+    char *items_ = items;
+    for(int i = 1; i < num_items; ++i)
+    {
+        wstatus[i] = outro_sort_dispatch(func, items_ + i * item_size, NULL, size, workers + i);
+        if(wstatus[i] < 0)
+        {
+            func(items_ + i * item_size, NULL);
+        }
+    }
+    func(items, NULL);
+    for(int i = 1; i < num_items; ++i)
+    {
+        outro_sort_join(workers + i, wstatus[i]);
+    }
+}
+
+/******************************************************************************
+ * Obtain the number of threads which can sort simultaneously. This is useful
+ * for dividing work into equal parts up front.
+ *
+ * @return Number of workers in the thread pool plus one (for the calling
+ *     thread) if it is running, else the number of threads which may be
+ *     created on demand, but at most the maximum number of threads of the sort
+ *     with a context the calling thread is working on.
+ *****************************************************************************/
+int
+outro_sort_concurrency(void)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    int available = outro_sort_pool_active() ? pool.num_workers + 1 : available_threads;
+    if(current_call != NULL && current_call->ctx->max_threads < available)
+    {
+        available = current_call->ctx->max_threads;
+    }
+    return available > 1 ? available : 1;
+#else
+    return 1;
+#endif
+}
+
+/******************************************************************************
+ * Find the number of threads which should process an array in chunks using
+ * `outro_sort_run`.
+ *
+ * @param size Number of elements.
+ * @param chunk_size Minimum number of elements each thread should process.
+ *
+ * @return Number of chunks, at least 1.
+ *****************************************************************************/
+int
+outro_sort_num_chunks(size_t size, size_t chunk_size)
+{
+    int num_chunks = outro_sort_concurrency();
+    if(num_chunks > OUTRO_SORT_RUN_MAX)
+    {
+        num_chunks = OUTRO_SORT_RUN_MAX;
+    }
+    if((size_t)num_chunks > size / chunk_size)
+    {
+        num_chunks = size / chunk_size > 0 ? size / chunk_size : 1;
+    }
+    return num_chunks;
+}
+
+/******************************************************************************
+ * Start a pool of threads which will be used by all subsequent sorts instead
+ * of creating a thread for every large subarray. Each worker has its own deque
+ * of subarrays to sort, and steals from the others when that is empty. Until
+ * the pool is started (or after it is shut down), threads are created on
+ * demand as configured using `outro_sort_configure`. If multithreading is not
+ * supported, the pool is not started.
+ *
+ * If the environment variable `OUTRO_SORT_PROFILE` names a profile (such as
+ * one written by the `tune` program), it is loaded into the global
+ * configuration first, and the pool is no larger than the maximum number of
+ * threads in it allows. If the pool cannot be started, the global
+ * configuration is left unchanged.
+ *
+ * This function must not be called while a sort is in progress.
+ *
+ * @param num_workers Number of threads to start. Unlike the limit configured
+ *     using `outro_sort_configure`, this should typically be equal to the
+ *     number of logical processors.
+ *
+ * @return 0 if the pool was started (or if multithreading is not supported),
+ *     else -1.
+ *****************************************************************************/
+int
+outro_sort_init(int num_workers)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(pool.active || num_workers < 1)
+    {
+        return -1;
+    }
+
+    // The profile is undone if the pool cannot be started.
+    struct OutroSortContext saved_config = outro_sort_config;
+    int saved_threads = available_threads;
+#endif
+    char const *profile = getenv("OUTRO_SORT_PROFILE");
+    if(profile != NULL && *profile != '\0' && outro_sort_configure_profile(profile) == 0 && num_workers >= outro_sort_config.max_threads)
+    {
+        num_workers = outro_sort_config.max_threads > 1 ? outro_sort_config.max_threads - 1 : 1;
+    }
+#ifdef MULTITHREADED_OUTRO_SORT
+    pool.num_workers = num_workers;
+    pool.workers = malloc(num_workers * sizeof *pool.workers);
+    pool.deques = malloc((num_workers + 1) * sizeof *pool.deques);
+    if(pool.workers == NULL || pool.deques == NULL)
+    {
+        free(pool.deques);
+        free(pool.workers);
+        outro_sort_config = saved_config;
+        available_threads = saved_threads;
+        return -1;
+    }
+    for(int i = 0; i <= num_workers; ++i)
+    {
+        mtx_init(&pool.deques[i].lock, mtx_plain);
+        pool.deques[i].head = pool.deques[i].count = 0;
+    }
+    mtx_init(&pool.lock, mtx_plain);
+    cnd_init(&pool.wake);
+    cnd_init(&pool.finished);
+    pool.jobs_head = pool.jobs_tail = NULL;
+    atomic_init(&pool.queued, 0);
+    atomic_init(&pool.stopping, false);
+    for(int i = 0; i < num_workers; ++i)
+    {
+        if(thrd_create(pool.workers + i, pool_worker, pool.deques + i) != thrd_success)
+        {
+            pool_destroy(i);
+            outro_sort_config = saved_config;
+            available_threads = saved_threads;
+            return -1;
+        }
+    }
+    pool.active = true;
+#else
+    (void)num_workers;
+#endif
+    return 0;
+}
+
+/******************************************************************************
+ * Stop the pool of threads started using `outro_sort_init`. Subsequent sorts
+ * will create threads on demand. This function must not be called while a
+ * sort is in progress. Asynchronous sorts submitted but not yet started are
+ * run before it returns; their handles must still be passed to
+ * `outro_sort_wait`.
+ *****************************************************************************/
+void
+outro_sort_shutdown(void)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(pool.active)
+    {
+        pool_destroy(pool.num_workers);
+    }
+#endif
+}
+
+#ifdef MULTITHREADED_OUTRO_SORT
+/******************************************************************************
+ * Helper function to perform an asynchronous sort in its own thread.
+ *
+ * @param job_
+ *
+ * @return Ignored.
+ *****************************************************************************/
+static int
+outro_sort_job_exec(void *job_)
+{
+    struct OutroSortJob *job = job_;
+    pool_run(&job->task);
+    return EXIT_SUCCESS;
+}
+#endif
+
+/******************************************************************************
+ * Start sorting a subarray without waiting for it to be sorted. If the thread
+ * pool is running, the sort is queued, and started by the first worker which
+ * runs out of work; all sorts share the workers, and each is split into tasks
+ * like any other. Otherwise, a thread is started for it (which counts towards
+ * the limit configured using `outro_sort_configure`), unless that limit has
+ * been reached, in which case nothing is started and the caller must sort the
+ * subarray itself. If multithreading is not supported, the subarray is sorted
+ * before this function returns.
+ *
+ * @param func Sort function.
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param job_ Handle to fill in, which must be passed to `outro_sort_wait`
+ *     exactly once.
+ *
+ * @return 0 if the sort was started, else -1, in which case the handle is not
+ *     filled in.
+ *****************************************************************************/
+int
+outro_sort_submit_task(void (*func)(void *, void *), void *begin, void *end, struct OutroSortJob **job_)
+{
+    struct OutroSortJob *job = malloc(sizeof *job);
+    if(job == NULL)
+    {
+        return -1;
+    }
+#ifdef MULTITHREADED_OUTRO_SORT
+    job->task.func = func;
+    job->task.begin = begin;
+    job->task.end = end;
+    job->task.job = job;
+    job->task.call = NULL;
+    atomic_init(&job->task.done, 0);
+    atomic_init(&job->cancelled, false);
+    atomic_init(&job->interrupted, false);
+    job->queued = false;
+    job->next = NULL;
+    job->threaded = !outro_sort_pool_active();
+    if(job->threaded)
+    {
+        if(!budget_reserve(&available_threads))
+        {
+            free(job);
+            return -1;
+        }
+        if(thrd_create(&job->thr, outro_sort_job_exec, job) != thrd_success)
+        {
+            ++available_threads;
+            free(job);
+            return -1;
+        }
+    }
+    else
+    {
+        mtx_lock(&pool.lock);
+        job->queued = true;
+        if(pool.jobs_tail != NULL)
+        {
+            pool.jobs_tail->next = job;
+        }
+        else
+        {
+            pool.jobs_head = job;
+        }
+        pool.jobs_tail = job;
+        atomic_fetch_add(&pool.queued, 1);
+        cnd_signal(&pool.wake);
+        mtx_unlock(&pool.lock);
+    }
+#else
+    func(begin, end);
+#endif
+    *job_ = job;
+    return 0;
+}
+
+/******************************************************************************
+ * Check whether an asynchronous sort has finished, because it either sorted
+ * the subarray or was cancelled.
+ *
+ * @param job Handle filled in by `outro_sort_submit`.
+ *
+ * @return 1 if it has finished, else 0.
+ *****************************************************************************/
+int
+outro_sort_poll(struct OutroSortJob *job)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    return atomic_load(&job->task.done);
+#else
+    (void)job;
+    return 1;
+#endif
+}
+
+/******************************************************************************
+ * Request that an asynchronous sort stop. If no thread has started it yet, it
+ * finishes immediately. Otherwise, parts of the subarray not yet partitioned
+ * (including those queued for other threads) are skipped as soon as a thread
+ * reaches them. The subarray is then a permutation of its original contents,
+ * but need not be sorted.
+ *
+ * @param job Handle filled in by `outro_sort_submit`.
+ *****************************************************************************/
+void
+outro_sort_cancel(struct OutroSortJob *job)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    atomic_store(&job->cancelled, true);
+    if(job->threaded || atomic_load(&job->task.done))
+    {
+        return;
+    }
+    mtx_lock(&pool.lock);
+    if(job->queued)
+    {
+        pool_unqueue(job);
+        atomic_store(&job->interrupted, true);
+        atomic_store(&job->task.done, 1);
+        cnd_broadcast(&pool.finished);
+    }
+    mtx_unlock(&pool.lock);
+#else
+    (void)job;
+#endif
+}
+
+/******************************************************************************
+ * Wait for an asynchronous sort to finish, and release its handle. If no
+ * thread has started it yet, the calling thread sorts the subarray itself.
+ *
+ * @param job Handle filled in by `outro_sort_submit`.
+ *
+ * @return 0 if the subarray was sorted, else -1, in which case the sort was
+ *     cancelled before it completed.
+ *****************************************************************************/
+int
+outro_sort_wait(struct OutroSortJob *job)
+{
+    int status = 0;
+#ifdef MULTITHREADED_OUTRO_SORT
+    if(job->threaded)
+    {
+        thrd_join(job->thr, NULL);
+        ++available_threads;
+    }
+    else if(!atomic_load(&job->task.done))
+    {
+        mtx_lock(&pool.lock);
+        bool queued = job->queued;
+        if(queued)
+        {
+            pool_unqueue(job);
+        }
+        while(!queued && !atomic_load(&job->task.done))
+        {
+            cnd_wait(&pool.finished, &pool.lock);
+        }
+        mtx_unlock(&pool.lock);
+        if(queued)
+        {
+            pool_run(&job->task);
+        }
+    }
+    status = atomic_load(&job->interrupted) ? -1 : 0;
+#endif
+    free(job);
+    return status;
+}
+
+/******************************************************************************
+ * Check whether the asynchronous sort the calling thread is working on (if
+ * any) was cancelled. Sort functions call this before each step which could be
+ * skipped.
+ *
+ * @return 1 if it was cancelled, else 0.
+ *****************************************************************************/
+int
+outro_sort_cancelled(void)
+{
+#ifdef MULTITHREADED_OUTRO_SORT
+    struct OutroSortJob *job = current_job;
+    if(job != NULL && atomic_load_explicit(&job->cancelled, memory_order_relaxed))
+    {
+        atomic_store_explicit(&job->interrupted, true, memory_order_relaxed);
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/******************************************************************************
+ * Initialise a context with the global configuration and the current thread
+ * budget, no scratch memory and no statistics.
+ *
+ * @param ctx Context.
+ *****************************************************************************/
+void
+outro_sort_context_init(struct OutroSortContext *ctx)
+{
+    *ctx = outro_sort_config;
+    ctx->max_threads = outro_sort_concurrency();
+    ctx->scratch = NULL;
+    ctx->scratch_size = 0;
+    memset(&ctx->stats, 0, sizeof ctx->stats);
+}
+
+/******************************************************************************
+ * Call a sort function with a context. All threads working on the sort use
+ * the settings of the context instead of the global ones. The sort reserves
+ * threads from the global budget and from its own (which starts at the
+ * maximum number of threads of the context) atomically, so that several
+ * sorts can run simultaneously without exceeding either. The numbers of
+ * subarrays dispatched are added to the statistics of the context.
+ *
+ * @param ctx Context.
+ * @param func Sort function.
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *****************************************************************************/
+void
+outro_sort_call(struct OutroSortContext *ctx, void (*func)(void *, void *), void *begin, void *end)
+{
+    struct OutroSortCall call;
+    call.ctx = ctx;
+#ifdef MULTITHREADED_OUTRO_SORT
+    atomic_init(&call.threads, ctx->max_threads);
+    atomic_init(&call.scratch_used, false);
+#else
+    call.scratch_used = false;
+#endif
+    CALL_COUNTER_INIT(call.queued);
+    CALL_COUNTER_INIT(call.spawned);
+    CALL_COUNTER_INIT(call.inlined);
+    struct OutroSortCall *outer = current_call;
+    current_call = &call;
+    func(begin, end);
+    current_call = outer;
+    ctx->stats.queued += CALL_COUNTER_LOAD(call.queued);
+    ctx->stats.spawned += CALL_COUNTER_LOAD(call.spawned);
+    ctx->stats.inlined += CALL_COUNTER_LOAD(call.inlined);
+}
+
+/******************************************************************************
+ * Obtain the settings which apply to the calling thread.
+ *
+ * @return Context of the sort the calling thread is working on, if any, else
+ *     the global configuration.
+ *****************************************************************************/
+struct OutroSortContext const *
+outro_sort_settings(void)
+{
+    return current_call != NULL ? current_call->ctx : &outro_sort_config;
+}
+
+/******************************************************************************
+ * Allocate a buffer. If the calling thread is working on a sort with a context
+ * which has enough scratch memory, and no other part of the sort is using it,
+ * that is used instead.
+ *
+ * @param size Number of bytes.
+ *
+ * @return Buffer, or `NULL` if memory could not be allocated.
+ *****************************************************************************/
+void *
+outro_sort_scratch_alloc(size_t size)
+{
+    struct OutroSortCall *call = current_call;
+    if(call != NULL && call->ctx->scratch != NULL && size <= call->ctx->scratch_size)
+    {
+#ifdef MULTITHREADED_OUTRO_SORT
+        if(!atomic_exchange(&call->scratch_used, true))
+#else
+        if(!call->scratch_used && (call->scratch_used = true))
+#endif
+        {
+            return call->ctx->scratch;
+        }
+    }
+    return malloc(size);
+}
+
+/******************************************************************************
+ * Release a buffer allocated using `outro_sort_scratch_alloc`.
+ *
+ * @param buffer
+ *****************************************************************************/
+void
+outro_sort_scratch_free(void *buffer)
+{
+    struct OutroSortCall *call = current_call;
+    if(call != NULL && buffer != NULL && buffer == call->ctx->scratch)
+    {
+#ifdef MULTITHREADED_OUTRO_SORT
+        atomic_store(&call->scratch_used, false);
+#else
+        call->scratch_used = false;
+#endif
+        return;
+    }
+    free(buffer);
+}
@@ -0,0 +1,60 @@
+#ifndef TFPF_VERSATILE_SORT_OUTRO_SORT_POOL_H_
+#define TFPF_VERSATILE_SORT_OUTRO_SORT_POOL_H_
+
+#include <stddef.h>
+
+struct OutroSortCall;
+struct OutroSortContext;
+struct OutroSortJob;
+
+#if !defined __STDC_NO_THREADS__ && !defined __STDC_NO_ATOMICS__
+#define MULTITHREADED_OUTRO_SORT
+#include <stdatomic.h>
+#include <threads.h>
+
+// A unit of work which can be executed by any thread of the pool. The thread
+// which forks it owns it, and must join it before it goes out of scope. It
+// belongs to the same asynchronous sort and the same sort with a context (if
+// any) as the thread which forked it.
+struct OutroSortTask
+{
+    void (*func)(void *, void *);
+    void *begin;
+    void *end;
+    struct OutroSortJob *job;
+    struct OutroSortCall *call;
+    atomic_int done;
+};
+
+// Handle to a subarray which may be sorted asynchronously.
+struct OutroSortWorker
+{
+    thrd_t thr;
+    struct OutroSortTask task;
+};
+
+int outro_sort_pool_active(void);
+int outro_sort_pool_fork(struct OutroSortTask *);
+void outro_sort_pool_join(struct OutroSortTask *);
+#else
+struct OutroSortWorker
+{
+    int unused;
+};
+#endif
+
+// Maximum number of items `outro_sort_run` can process simultaneously.
+#define OUTRO_SORT_RUN_MAX 64
+
+int outro_sort_concurrency(void);
+int outro_sort_num_chunks(size_t, size_t);
+int outro_sort_dispatch(void (*)(void *, void *), void *, void *, size_t, struct OutroSortWorker *);
+void outro_sort_join(struct OutroSortWorker *, int);
+void outro_sort_run(void (*)(void *, void *), void *, size_t, int, size_t);
+int outro_sort_submit_task(void (*)(void *, void *), void *, void *, struct OutroSortJob **);
+int outro_sort_cancelled(void);
+void outro_sort_call(struct OutroSortContext *, void (*)(void *, void *), void *, void *);
+void *outro_sort_scratch_alloc(size_t);
+void outro_sort_scratch_free(void *);
+
+#endif  // TFPF_VERSATILE_SORT_OUTRO_SORT_POOL_H_
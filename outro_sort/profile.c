@@ -0,0 +1,495 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "outro_sort.h"
+
+// Number of rounds in which every candidate for a parameter is timed once.
+// Candidates are timed one after another within each round, so that a slow
+// period of the machine (which may last several rounds) affects all of them
+// alike. Each candidate is then judged by the median ratio of its time to that
+// of the current choice in the same round.
+#define TUNE_ROUNDS 9
+
+// Fraction by which the median ratio of a candidate must be less than 1 for it
+// to replace the current choice. Without this, noise would decide between
+// nearly equal candidates, and tuning twice would give different profiles.
+#define TUNE_MARGIN 0.1
+
+// Minimum duration of a time sample, in seconds. Shorter sorts are repeated
+// within each sample, since their times vary too much.
+#define TUNE_SAMPLE_TIME 0.012
+
+// Maximum number of candidates for a parameter (including the current one).
+#define TUNE_CANDIDATES 16
+
+// Values tried for each parameter, besides the one in the global
+// configuration (which is kept unless another value is clearly better).
+static size_t const radix_thresholds[] = {0, 16384U, 65536U, 262144U, 1048576U};
+static size_t const leaf_sizes[] = {8, 12, 16, 24, 32, 48};
+static size_t const multithreading_thresholds[] = {8192U, 16384U, 32768U, 65536U, 131072U, 262144U};
+static enum OutroSortPartition const partitions[] =
+{
+    OUTRO_SORT_PARTITION_AUTO,
+    OUTRO_SORT_PARTITION_HOARE,
+    OUTRO_SORT_PARTITION_BLOCK,
+    OUTRO_SORT_PARTITION_AVX2,
+    OUTRO_SORT_PARTITION_AVX512,
+};
+
+// Names of the partitioning methods and modes in profiles.
+static char const *const partition_names[] = {"auto", "hoare", "block", "avx2", "avx512"};
+static char const *const mode_names[] = {"partition", "sample"};
+
+// State of the tuner: the array to sort, the best context found so far, and
+// the candidates for the parameter being chosen (the first being the best
+// context).
+struct Tuner
+{
+    int const *data;
+    int *arr;
+    size_t size;
+    int sorts_per_sample;
+    struct OutroSortContext best;
+    struct OutroSortContext candidates[TUNE_CANDIDATES];
+    int num_candidates;
+};
+
+/******************************************************************************
+ * Generate the next pseudorandom number of a sequence. (This is SplitMix64,
+ * which does not depend on the state of `rand`, so that the same seed always
+ * gives the same data.)
+ *
+ * @param state State of the sequence.
+ *
+ * @return Pseudorandom number.
+ *****************************************************************************/
+static uint64_t
+splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ z >> 30) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ z >> 27) * UINT64_C(0x94D049BB133111EB);
+    return z ^ z >> 31;
+}
+
+/******************************************************************************
+ * Measure how long sorting the data takes with a context.
+ *
+ * @param tuner
+ * @param ctx Context.
+ *
+ * @return Total running time of the sorts in a sample, in seconds.
+ *****************************************************************************/
+static double
+measure(struct Tuner *tuner, struct OutroSortContext *ctx)
+{
+    double elapsed = 0.0;
+    for(int i = 0; i < tuner->sorts_per_sample; ++i)
+    {
+        memcpy(tuner->arr, tuner->data, tuner->size * sizeof *tuner->arr);
+        struct timespec start, stop;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        outro_sort_ctx(ctx, tuner->arr, tuner->arr + tuner->size);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        elapsed += (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    }
+    return elapsed;
+}
+
+/******************************************************************************
+ * Start collecting candidates for a parameter.
+ *
+ * @param tuner
+ *****************************************************************************/
+static void
+begin_candidates(struct Tuner *tuner)
+{
+    tuner->candidates[0] = tuner->best;
+    tuner->num_candidates = 1;
+}
+
+/******************************************************************************
+ * Add a candidate for a parameter.
+ *
+ * @param tuner
+ *
+ * @return Copy of the best context, to change the parameter of.
+ *****************************************************************************/
+static struct OutroSortContext *
+add_candidate(struct Tuner *tuner)
+{
+    struct OutroSortContext *candidate = tuner->candidates + tuner->num_candidates++;
+    *candidate = tuner->best;
+    return candidate;
+}
+
+/******************************************************************************
+ * Compare ratios of running times.
+ *
+ * @param a
+ * @param b
+ *
+ * @return Negative, zero or positive as `a` is less than, equal to or greater
+ *     than `b`.
+ *****************************************************************************/
+static int
+compare_ratios(void const *a, void const *b)
+{
+    double const *a_ = a, *b_ = b;
+    return (*a_ > *b_) - (*a_ < *b_);
+}
+
+/******************************************************************************
+ * Time the candidates for a parameter in interleaved rounds, and find the
+ * median ratio of the time of each to that of the current choice.
+ *
+ * @param tuner
+ * @param ratios Array to store the median ratio of each candidate in.
+ *****************************************************************************/
+static void
+time_candidates(struct Tuner *tuner, double *ratios)
+{
+    double times[TUNE_CANDIDATES][TUNE_ROUNDS];
+    for(int round = 0; round < TUNE_ROUNDS; ++round)
+    {
+        for(int i = 0; i < tuner->num_candidates; ++i)
+        {
+            times[i][round] = measure(tuner, tuner->candidates + i);
+        }
+    }
+    for(int i = 0; i < tuner->num_candidates; ++i)
+    {
+        double round_ratios[TUNE_ROUNDS];
+        for(int round = 0; round < TUNE_ROUNDS; ++round)
+        {
+            round_ratios[round] = times[i][round] / times[0][round];
+        }
+        qsort(round_ratios, TUNE_ROUNDS, sizeof *round_ratios, compare_ratios);
+        ratios[i] = round_ratios[TUNE_ROUNDS / 2];
+    }
+}
+
+/******************************************************************************
+ * Make the candidate for a parameter with the least median ratio of its time
+ * to that of the current choice the best context, if it is clearly faster.
+ * Since the least of several ratios is biased low, the winner is timed against
+ * the current choice once more, and must beat it by the margin again.
+ *
+ * @param tuner
+ *****************************************************************************/
+static void
+choose_candidate(struct Tuner *tuner)
+{
+    double ratios[TUNE_CANDIDATES];
+    time_candidates(tuner, ratios);
+    int best = 0;
+    for(int i = 1; i < tuner->num_candidates; ++i)
+    {
+        if(ratios[i] < 1.0 - TUNE_MARGIN && ratios[i] < ratios[best])
+        {
+            best = i;
+        }
+    }
+    if(best == 0)
+    {
+        return;
+    }
+    tuner->candidates[1] = tuner->candidates[best];
+    tuner->num_candidates = 2;
+    time_candidates(tuner, ratios);
+    if(ratios[1] < 1.0 - TUNE_MARGIN)
+    {
+        tuner->best = tuner->candidates[1];
+    }
+}
+
+/******************************************************************************
+ * Find the settings with which this machine sorts fastest. Starting from the
+ * global configuration and the current thread budget, the radix sort
+ * threshold, the partitioning method, the leaf size, the maximum number of
+ * threads and the multithreading threshold are chosen in turn: the values in
+ * a small grid are timed on the same pseudorandom array of `int`s (the other
+ * parameters keeping their best values so far), and the one with the least
+ * median ratio of its time to that of the current value wins if it beats it by
+ * a clear margin. Since the radix sort threshold is chosen first, the other
+ * parameters are tuned as they will actually be used. Tuning takes a few
+ * seconds (more if the array is so large that each sort takes longer than
+ * 12 ms), and does not change the global configuration.
+ *
+ * @param ctx Context to initialise with the best settings found.
+ * @param size Number of elements to sort. Larger arrays give more reliable
+ *     results, but take longer.
+ * @param seed Seed of the array. With the same seed (and on an otherwise idle
+ *     machine), the same profile is found every time.
+ *
+ * @return 0 if the context was initialised, else -1, in which case memory
+ *     could not be allocated.
+ *****************************************************************************/
+int
+outro_sort_tune(struct OutroSortContext *ctx, size_t size, uint64_t seed)
+{
+    struct Tuner tuner;
+    int *data = malloc(size * sizeof *data);
+    tuner.arr = malloc(size * sizeof *tuner.arr);
+    if(size == 0 || data == NULL || tuner.arr == NULL)
+    {
+        free(tuner.arr);
+        free(data);
+        return -1;
+    }
+    for(size_t i = 0; i < size; ++i)
+    {
+        data[i] = (int)(splitmix64(&seed) >> 32);
+    }
+    tuner.data = data;
+    tuner.size = size;
+    outro_sort_context_init(&tuner.best);
+    tuner.best.mode = OUTRO_SORT_MODE_PARTITION;
+
+    // Warm up (faulting in the pages of the arrays) before the first
+    // measurement which counts, and find how many sorts make a sample.
+    tuner.sorts_per_sample = 1;
+    measure(&tuner, &tuner.best);
+    double elapsed = measure(&tuner, &tuner.best);
+    tuner.sorts_per_sample = elapsed < TUNE_SAMPLE_TIME ? (int)(TUNE_SAMPLE_TIME / elapsed) + 1 : 1;
+
+    begin_candidates(&tuner);
+    for(size_t i = 0; i < sizeof radix_thresholds / sizeof *radix_thresholds; ++i)
+    {
+        if(radix_thresholds[i] != tuner.best.radix_threshold)
+        {
+            add_candidate(&tuner)->radix_threshold = radix_thresholds[i];
+        }
+    }
+    choose_candidate(&tuner);
+
+    begin_candidates(&tuner);
+    for(size_t i = 0; i < sizeof partitions / sizeof *partitions; ++i)
+    {
+        if(partitions[i] != tuner.best.partition)
+        {
+            add_candidate(&tuner)->partition = partitions[i];
+        }
+    }
+    choose_candidate(&tuner);
+
+    begin_candidates(&tuner);
+    for(size_t i = 0; i < sizeof leaf_sizes / sizeof *leaf_sizes; ++i)
+    {
+        if(leaf_sizes[i] != tuner.best.leaf_size)
+        {
+            add_candidate(&tuner)->leaf_size = leaf_sizes[i];
+        }
+    }
+    choose_candidate(&tuner);
+
+    // Halve the thread budget until only one thread is left.
+    begin_candidates(&tuner);
+    for(int threads = tuner.best.max_threads / 2; threads >= 1 && tuner.num_candidates < TUNE_CANDIDATES; threads /= 2)
+    {
+        add_candidate(&tuner)->max_threads = threads;
+    }
+    choose_candidate(&tuner);
+
+    if(tuner.best.max_threads > 1)
+    {
+        begin_candidates(&tuner);
+        for(size_t i = 0; i < sizeof multithreading_thresholds / sizeof *multithreading_thresholds; ++i)
+        {
+            if(multithreading_thresholds[i] != tuner.best.multithreading_threshold)
+            {
+                add_candidate(&tuner)->multithreading_threshold = multithreading_thresholds[i];
+            }
+        }
+        choose_candidate(&tuner);
+    }
+
+    *ctx = tuner.best;
+    memset(&ctx->stats, 0, sizeof ctx->stats);
+    free(tuner.arr);
+    free(data);
+    return 0;
+}
+
+/******************************************************************************
+ * Write the settings of a context to a profile, which can be loaded using
+ * `outro_sort_profile_load`. Each line of a profile contains a parameter name
+ * and its value.
+ *
+ * @param ctx Context.
+ * @param path Path of the profile.
+ *
+ * @return 0 if the profile was written, else -1.
+ *****************************************************************************/
+int
+outro_sort_profile_save(struct OutroSortContext const *ctx, char const *path)
+{
+    FILE *profile = fopen(path, "w");
+    if(profile == NULL)
+    {
+        return -1;
+    }
+    fprintf(profile, "# outro sort profile\n");
+    fprintf(profile, "max_threads %d\n", ctx->max_threads);
+    fprintf(profile, "multithreading_threshold %zu\n", ctx->multithreading_threshold);
+    fprintf(profile, "radix_threshold %zu\n", ctx->radix_threshold);
+    fprintf(profile, "partition %s\n", partition_names[ctx->partition]);
+    fprintf(profile, "mode %s\n", mode_names[ctx->mode]);
+    fprintf(profile, "parallel_partition_threshold %zu\n", ctx->parallel_partition_threshold);
+    fprintf(profile, "leaf_size %zu\n", ctx->leaf_size);
+    int failed = ferror(profile);
+    return fclose(profile) == 0 && !failed ? 0 : -1;
+}
+
+/******************************************************************************
+ * Find the index of a name in a list.
+ *
+ * @param names
+ * @param num_names Number of names.
+ * @param name Name to find.
+ *
+ * @return Index, or -1 if the name is not in the list.
+ *****************************************************************************/
+static int
+find_name(char const *const names[], int num_names, char const *name)
+{
+    for(int i = 0; i < num_names; ++i)
+    {
+        if(strcmp(names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/******************************************************************************
+ * Parse a size in a profile.
+ *
+ * @param text Text to parse.
+ * @param value Variable to store the size in.
+ *
+ * @return 0 if the text is a size, else -1.
+ *****************************************************************************/
+static int
+parse_size(char const *text, size_t *value)
+{
+    char *endptr;
+    unsigned long long parsed = strtoull(text, &endptr, 10);
+    if(*text == '-' || endptr == text || *endptr != '\0' || parsed > SIZE_MAX)
+    {
+        return -1;
+    }
+    *value = parsed;
+    return 0;
+}
+
+/******************************************************************************
+ * Read the settings of a context from a profile written by
+ * `outro_sort_profile_save`. Parameters missing from the profile keep their
+ * values, and unknown ones (blank lines, and lines starting with `#`) are
+ * ignored.
+ *
+ * @param ctx Context.
+ * @param path Path of the profile.
+ *
+ * @return 0 if the profile was read, else -1, in which case it could not be
+ *     opened or contains an invalid value, and the context is unchanged.
+ *****************************************************************************/
+int
+outro_sort_profile_load(struct OutroSortContext *ctx, char const *path)
+{
+    FILE *profile = fopen(path, "r");
+    if(profile == NULL)
+    {
+        return -1;
+    }
+    struct OutroSortContext loaded = *ctx;
+    int status = 0;
+    for(char line[256]; status == 0 && fgets(line, sizeof line, profile) != NULL;)
+    {
+        char name[64], value[64];
+        if(line[0] == '#' || sscanf(line, "%63s %63s", name, value) != 2)
+        {
+            continue;
+        }
+        size_t size = 0;
+        int index;
+        if(strcmp(name, "max_threads") == 0)
+        {
+            status = parse_size(value, &size) == 0 && 0 < size && size <= 1024 ? 0 : -1;
+            loaded.max_threads = size;
+        }
+        else if(strcmp(name, "multithreading_threshold") == 0)
+        {
+            status = parse_size(value, &loaded.multithreading_threshold);
+        }
+        else if(strcmp(name, "radix_threshold") == 0)
+        {
+            status = parse_size(value, &loaded.radix_threshold);
+        }
+        else if(strcmp(name, "partition") == 0)
+        {
+            index = find_name(partition_names, sizeof partition_names / sizeof *partition_names, value);
+            status = index >= 0 ? 0 : -1;
+            loaded.partition = index;
+        }
+        else if(strcmp(name, "mode") == 0)
+        {
+            index = find_name(mode_names, sizeof mode_names / sizeof *mode_names, value);
+            status = index >= 0 ? 0 : -1;
+            loaded.mode = index;
+        }
+        else if(strcmp(name, "parallel_partition_threshold") == 0)
+        {
+            status = parse_size(value, &loaded.parallel_partition_threshold);
+        }
+        else if(strcmp(name, "leaf_size") == 0)
+        {
+            status = parse_size(value, &size) == 0 && size >= 3 ? 0 : -1;
+            loaded.leaf_size = size;
+        }
+    }
+    if(ferror(profile))
+    {
+        status = -1;
+    }
+    fclose(profile);
+    if(status == 0)
+    {
+        *ctx = loaded;
+    }
+    return status;
+}
+
+/******************************************************************************
+ * Load a profile into the global configuration. The maximum number of threads
+ * and the multithreading threshold are applied as by `outro_sort_configure`.
+ *
+ * @param path Path of the profile.
+ *
+ * @return 0 if the profile was loaded, else -1, in which case the global
+ *     configuration is unchanged.
+ *****************************************************************************/
+int
+outro_sort_configure_profile(char const *path)
+{
+    struct OutroSortContext loaded = outro_sort_config;
+    if(outro_sort_profile_load(&loaded, path) != 0)
+    {
+        return -1;
+    }
+    outro_sort_configure(loaded.max_threads, loaded.multithreading_threshold);
+    outro_sort_configure_radix(loaded.radix_threshold);
+    outro_sort_configure_partition(loaded.partition);
+    outro_sort_configure_mode(loaded.mode);
+    outro_sort_configure_parallel_partition(loaded.parallel_partition_threshold);
+    outro_sort_configure_leaf(loaded.leaf_size);
+    return 0;
+}
@@ -0,0 +1,373 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "simd.h"
+
+// Exactly one of these may be defined to force the use of the respective
+// partitioning kernel. Otherwise, the one selected using
+// `outro_sort_configure_partition` is used if the processor supports it.
+#if defined OUTRO_SORT_SIMD_SCALAR + defined OUTRO_SORT_SIMD_AVX2 + defined OUTRO_SORT_SIMD_AVX512 > 1
+#error "at most one of OUTRO_SORT_SIMD_SCALAR, OUTRO_SORT_SIMD_AVX2 and OUTRO_SORT_SIMD_AVX512 may be defined"
+#endif
+
+#if (defined __x86_64__ || defined __i386__) && defined __GNUC__
+#define OUTRO_SORT_X86
+#include <immintrin.h>
+#elif defined OUTRO_SORT_SIMD_AVX2 || defined OUTRO_SORT_SIMD_AVX512
+#error "SIMD partitioning kernels require an x86 processor and GCC or Clang"
+#endif
+
+#if defined OUTRO_SORT_X86 && !defined OUTRO_SORT_SIMD_SCALAR
+/******************************************************************************
+ * Move the elements of a buffer to the free space between the two parts of a
+ * partially partitioned subarray.
+ *
+ * @param buffer
+ * @param size Number of elements in the buffer.
+ * @param left Pointer to one past the last element less than the bound.
+ * @param right Pointer to the first element not less than the bound.
+ * @param bound
+ *
+ * @return Partition pointer.
+ *****************************************************************************/
+static int *
+partition_flush(int const *buffer, size_t size, int *left, int *right, int bound)
+{
+    for(size_t i = 0; i < size; ++i)
+    {
+        if(buffer[i] < bound)
+        {
+            *left++ = buffer[i];
+        }
+        else
+        {
+            *--right = buffer[i];
+        }
+    }
+    return left;
+}
+
+#ifndef OUTRO_SORT_SIMD_AVX512
+// Permutations which move the lanes of a vector of 8 integers selected by an
+// 8-bit mask to the front, and the remaining ones to the back, maintaining
+// their order. Each permutation is encoded as 8 3-bit lane indices.
+static uint32_t const avx2_permutations[256] = {
+    0xFAC688, 0xFAC688, 0xFAC681, 0xFAC688, 0xFAC642, 0xFAC650, 0xFAC611, 0xFAC688,
+    0xFAC443, 0xFAC458, 0xFAC419, 0xFAC4C8, 0xFAC21A, 0xFAC2D0, 0xFAC0D1, 0xFAC688,
+    0xFAB444, 0xFAB460, 0xFAB421, 0xFAB508, 0xFAB222, 0xFAB310, 0xFAB111, 0xFAB888,
+    0xFAA223, 0xFAA318, 0xFAA119, 0xFAA8C8, 0xFA911A, 0xFA98D0, 0xFA88D1, 0xFAC688,
+    0xFA3445, 0xFA3468, 0xFA3429, 0xFA3548, 0xFA322A, 0xFA3350, 0xFA3151, 0xFA3A88,
+    0xFA222B, 0xFA2358, 0xFA2159, 0xFA2AC8, 0xFA115A, 0xFA1AD0, 0xFA0AD1, 0xFA5688,
+    0xF9A22C, 0xF9A360, 0xF9A161, 0xF9AB08, 0xF99162, 0xF99B10, 0xF98B11, 0xF9D888,
+    0xF91163, 0xF91B18, 0xF90B19, 0xF958C8, 0xF88B1A, 0xF8D8D0, 0xF858D1, 0xFAC688,
+    0xF63446, 0xF63470, 0xF63431, 0xF63588, 0xF63232, 0xF63390, 0xF63191, 0xF63C88,
+    0xF62233, 0xF62398, 0xF62199, 0xF62CC8, 0xF6119A, 0xF61CD0, 0xF60CD1, 0xF66688,
+    0xF5A234, 0xF5A3A0, 0xF5A1A1, 0xF5AD08, 0xF591A2, 0xF59D10, 0xF58D11, 0xF5E888,
+    0xF511A3, 0xF51D18, 0xF50D19, 0xF568C8, 0xF48D1A, 0xF4E8D0, 0xF468D1, 0xF74688,
+    0xF1A235, 0xF1A3A8, 0xF1A1A9, 0xF1AD48, 0xF191AA, 0xF19D50, 0xF18D51, 0xF1EA88,
+    0xF111AB, 0xF11D58, 0xF10D59, 0xF16AC8, 0xF08D5A, 0xF0EAD0, 0xF06AD1, 0xF35688,
+    0xED11AC, 0xED1D60, 0xED0D61, 0xED6B08, 0xEC8D62, 0xECEB10, 0xEC6B11, 0xEF5888,
+    0xE88D63, 0xE8EB18, 0xE86B19, 0xEB58C8, 0xE46B1A, 0xE758D0, 0xE358D1, 0xFAC688,
+    0xD63447, 0xD63478, 0xD63439, 0xD635C8, 0xD6323A, 0xD633D0, 0xD631D1, 0xD63E88,
+    0xD6223B, 0xD623D8, 0xD621D9, 0xD62EC8, 0xD611DA, 0xD61ED0, 0xD60ED1, 0xD67688,
+    0xD5A23C, 0xD5A3E0, 0xD5A1E1, 0xD5AF08, 0xD591E2, 0xD59F10, 0xD58F11, 0xD5F888,
+    0xD511E3, 0xD51F18, 0xD50F19, 0xD578C8, 0xD48F1A, 0xD4F8D0, 0xD478D1, 0xD7C688,
+    0xD1A23D, 0xD1A3E8, 0xD1A1E9, 0xD1AF48, 0xD191EA, 0xD19F50, 0xD18F51, 0xD1FA88,
+    0xD111EB, 0xD11F58, 0xD10F59, 0xD17AC8, 0xD08F5A, 0xD0FAD0, 0xD07AD1, 0xD3D688,
+    0xCD11EC, 0xCD1F60, 0xCD0F61, 0xCD7B08, 0xCC8F62, 0xCCFB10, 0xCC7B11, 0xCFD888,
+    0xC88F63, 0xC8FB18, 0xC87B19, 0xCBD8C8, 0xC47B1A, 0xC7D8D0, 0xC3D8D1, 0xDEC688,
+    0xB1A23E, 0xB1A3F0, 0xB1A1F1, 0xB1AF88, 0xB191F2, 0xB19F90, 0xB18F91, 0xB1FC88,
+    0xB111F3, 0xB11F98, 0xB10F99, 0xB17CC8, 0xB08F9A, 0xB0FCD0, 0xB07CD1, 0xB3E688,
+    0xAD11F4, 0xAD1FA0, 0xAD0FA1, 0xAD7D08, 0xAC8FA2, 0xACFD10, 0xAC7D11, 0xAFE888,
+    0xA88FA3, 0xA8FD18, 0xA87D19, 0xABE8C8, 0xA47D1A, 0xA7E8D0, 0xA3E8D1, 0xBF4688,
+    0x8D11F5, 0x8D1FA8, 0x8D0FA9, 0x8D7D48, 0x8C8FAA, 0x8CFD50, 0x8C7D51, 0x8FEA88,
+    0x888FAB, 0x88FD58, 0x887D59, 0x8BEAC8, 0x847D5A, 0x87EAD0, 0x83EAD1, 0x9F5688,
+    0x688FAC, 0x68FD60, 0x687D61, 0x6BEB08, 0x647D62, 0x67EB10, 0x63EB11, 0x7F5888,
+    0x447D63, 0x47EB18, 0x43EB19, 0x5F58C8, 0x23EB1A, 0x3F58D0, 0x1F58D1, 0xFAC688,
+};
+
+/******************************************************************************
+ * Partition a subarray using AVX2 instructions: group all elements less than
+ * the bound on the left, and all other elements on the right. Vectors are
+ * read from whichever end has less free space, so that a whole vector can
+ * always be written to both ends.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element. There must be at least 16
+ *     elements.
+ * @param bound
+ *
+ * @return Partition pointer.
+ *****************************************************************************/
+__attribute__((target("avx2")))
+static int *
+partition_avx2(int *begin, int *end, int bound)
+{
+    int buffer[24];
+    __m256i bounds = _mm256_set1_epi32(bound);
+    __m256i shifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    _mm256_storeu_si256((__m256i *)buffer, _mm256_loadu_si256((__m256i const *)begin));
+    _mm256_storeu_si256((__m256i *)(buffer + 8), _mm256_loadu_si256((__m256i const *)(end - 8)));
+    int *left = begin, *right = end;
+    int *read_left = begin + 8, *read_right = end - 8;
+    while(read_right - read_left >= 8)
+    {
+        __m256i vec;
+        if(read_left - left <= right - read_right)
+        {
+            vec = _mm256_loadu_si256((__m256i const *)read_left);
+            read_left += 8;
+        }
+        else
+        {
+            read_right -= 8;
+            vec = _mm256_loadu_si256((__m256i const *)read_right);
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(bounds, vec)));
+        __m256i permutation = _mm256_srlv_epi32(_mm256_set1_epi32(avx2_permutations[mask]), shifts);
+        vec = _mm256_permutevar8x32_epi32(vec, _mm256_and_si256(permutation, _mm256_set1_epi32(7)));
+        int num_less = __builtin_popcount(mask);
+        _mm256_storeu_si256((__m256i *)left, vec);
+        _mm256_storeu_si256((__m256i *)(right - 8), vec);
+        left += num_less;
+        right -= 8 - num_less;
+    }
+    size_t size = 16;
+    while(read_left < read_right)
+    {
+        buffer[size++] = *read_left++;
+    }
+    return partition_flush(buffer, size, left, right, bound);
+}
+
+#endif
+
+#ifndef OUTRO_SORT_SIMD_AVX2
+/******************************************************************************
+ * Partition a subarray using AVX-512 instructions: group all elements less
+ * than the bound on the left, and all other elements on the right. Vectors are
+ * read from whichever end has less free space, so that a whole vector can
+ * always be written to both ends.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element. There must be at least 32
+ *     elements.
+ * @param bound
+ *
+ * @return Partition pointer.
+ *****************************************************************************/
+__attribute__((target("avx512f")))
+static int *
+partition_avx512(int *begin, int *end, int bound)
+{
+    int buffer[48];
+    __m512i bounds = _mm512_set1_epi32(bound);
+    _mm512_storeu_si512(buffer, _mm512_loadu_si512(begin));
+    _mm512_storeu_si512(buffer + 16, _mm512_loadu_si512(end - 16));
+    int *left = begin, *right = end;
+    int *read_left = begin + 16, *read_right = end - 16;
+    while(read_right - read_left >= 16)
+    {
+        __m512i vec;
+        if(read_left - left <= right - read_right)
+        {
+            vec = _mm512_loadu_si512(read_left);
+            read_left += 16;
+        }
+        else
+        {
+            read_right -= 16;
+            vec = _mm512_loadu_si512(read_right);
+        }
+        __mmask16 mask = _mm512_cmplt_epi32_mask(vec, bounds);
+        int num_less = __builtin_popcount(mask);
+        int num_greater = 16 - num_less;
+        _mm512_storeu_si512(left, _mm512_maskz_compress_epi32(mask, vec));
+        _mm512_mask_storeu_epi32(right - num_greater, (1U << num_greater) - 1, _mm512_maskz_compress_epi32(~mask, vec));
+        left += num_less;
+        right -= num_greater;
+    }
+    size_t size = 32;
+    while(read_left < read_right)
+    {
+        buffer[size++] = *read_left++;
+    }
+    return partition_flush(buffer, size, left, right, bound);
+}
+#endif
+
+// Bitonic sorting network for 16 elements: the distance between the lanes
+// compared in each stage, and the lanes which receive the lesser element.
+static int const network_distances[10] = {1, 2, 1, 4, 2, 1, 8, 4, 2, 1};
+static uint16_t const network_masks[10] = {0x9999, 0xC3C3, 0xA5A5, 0xF00F, 0xCC33, 0xAA55, 0x00FF, 0x0F0F, 0x3333, 0x5555};
+
+#ifndef OUTRO_SORT_SIMD_AVX512
+/******************************************************************************
+ * Sort at most 16 elements using a bitonic sorting network implemented with
+ * AVX2 instructions. The elements are held in two vectors, padded with the
+ * greatest integer.
+ *
+ * @param begin Pointer to the first element.
+ * @param size Number of elements.
+ *****************************************************************************/
+__attribute__((target("avx2")))
+static void
+network_avx2(int *begin, int size)
+{
+    int buffer[16];
+    for(int i = 0; i < 16; ++i)
+    {
+        buffer[i] = INT_MAX;
+    }
+    memcpy(buffer, begin, size * sizeof *begin);
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i vec[] = {
+        _mm256_loadu_si256((__m256i const *)buffer),
+        _mm256_loadu_si256((__m256i const *)(buffer + 8)),
+    };
+    for(int i = 0; i < 10; ++i)
+    {
+        if(network_distances[i] == 8)
+        {
+            __m256i tmp = _mm256_min_epi32(vec[0], vec[1]);
+            vec[1] = _mm256_max_epi32(vec[0], vec[1]);
+            vec[0] = tmp;
+            continue;
+        }
+        __m256i permutation = _mm256_xor_si256(lanes, _mm256_set1_epi32(network_distances[i]));
+        for(int j = 0; j < 2; ++j)
+        {
+            __m256i other = _mm256_permutevar8x32_epi32(vec[j], permutation);
+            __m256i less = _mm256_and_si256(_mm256_set1_epi32(network_masks[i] >> 8 * j), bits);
+            vec[j] = _mm256_blendv_epi8(_mm256_max_epi32(vec[j], other), _mm256_min_epi32(vec[j], other), _mm256_cmpeq_epi32(less, bits));
+        }
+    }
+    _mm256_storeu_si256((__m256i *)buffer, vec[0]);
+    _mm256_storeu_si256((__m256i *)(buffer + 8), vec[1]);
+    memcpy(begin, buffer, size * sizeof *begin);
+}
+#endif
+
+#ifndef OUTRO_SORT_SIMD_AVX2
+/******************************************************************************
+ * Sort at most 16 elements using a bitonic sorting network implemented with
+ * AVX-512 instructions. The elements are held in one vector, padded with the
+ * greatest integer.
+ *
+ * @param begin Pointer to the first element.
+ * @param size Number of elements.
+ *****************************************************************************/
+__attribute__((target("avx512f")))
+static void
+network_avx512(int *begin, int size)
+{
+    __mmask16 valid = (1U << size) - 1;
+    __m512i vec = _mm512_mask_loadu_epi32(_mm512_set1_epi32(INT_MAX), valid, begin);
+    __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    for(int i = 0; i < 10; ++i)
+    {
+        __m512i other = _mm512_permutexvar_epi32(_mm512_xor_si512(lanes, _mm512_set1_epi32(network_distances[i])), vec);
+        vec = _mm512_mask_blend_epi32(network_masks[i], _mm512_max_epi32(vec, other), _mm512_min_epi32(vec, other));
+    }
+    _mm512_mask_storeu_epi32(begin, valid, vec);
+}
+#endif
+#endif
+
+/******************************************************************************
+ * Partition a subarray using the selected vectorised kernel.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ * @param pivot_val Pivot, which must be one of the elements.
+ *
+ * @return Partition pointer, with all elements at lower addresses less than
+ *     or equal to the pivot, and all other elements greater than or equal to
+ *     it. Neither part is empty. `NULL` if no kernel can be used (in which
+ *     case the subarray may have been permuted).
+ *****************************************************************************/
+int *
+outro_sort_partition_simd(int *begin, int *end, int pivot_val)
+{
+    int *(*kernel)(int *, int *, int) = NULL;
+    ptrdiff_t min_size = 0;
+#if defined OUTRO_SORT_SIMD_AVX512
+    kernel = partition_avx512;
+    min_size = 32;
+#elif defined OUTRO_SORT_SIMD_AVX2
+    kernel = partition_avx2;
+    min_size = 16;
+#elif defined OUTRO_SORT_X86 && !defined OUTRO_SORT_SIMD_SCALAR
+    enum OutroSortPartition partition = outro_sort_settings()->partition;
+    bool avx512 = __builtin_cpu_supports("avx512f"), avx2 = __builtin_cpu_supports("avx2");
+    if(partition == OUTRO_SORT_PARTITION_AVX512 || (partition == OUTRO_SORT_PARTITION_AUTO && avx512 && end - begin >= 32))
+    {
+        kernel = avx512 ? partition_avx512 : NULL;
+        min_size = 32;
+    }
+    else if(partition == OUTRO_SORT_PARTITION_AVX2 || partition == OUTRO_SORT_PARTITION_AUTO)
+    {
+        kernel = avx2 ? partition_avx2 : NULL;
+        min_size = 16;
+    }
+#endif
+    if(kernel == NULL || end - begin < min_size)
+    {
+        return NULL;
+    }
+
+    // Elements less than the pivot go to the left. If there are none, the
+    // pivot is the least element, so elements equal to it go to the left
+    // instead. If that moves all of them, all elements are equal.
+    int *ploc = kernel(begin, end, pivot_val);
+    if(ploc == begin && pivot_val < INT_MAX)
+    {
+        ploc = kernel(begin, end, pivot_val + 1);
+    }
+    if(ploc == begin || ploc == end)
+    {
+        return NULL;
+    }
+    return ploc;
+}
+
+/******************************************************************************
+ * Sort a small subarray using the fastest vectorised sorting network
+ * available.
+ *
+ * @param begin Pointer to the first element.
+ * @param end Pointer to one past the last element.
+ *
+ * @return 0 if the subarray was sorted, else -1, in which case it is
+ *     unchanged.
+ *****************************************************************************/
+int
+outro_sort_network_simd(int *begin, int *end)
+{
+    void (*kernel)(int *, int) = NULL;
+#if defined OUTRO_SORT_SIMD_AVX512
+    kernel = network_avx512;
+#elif defined OUTRO_SORT_SIMD_AVX2
+    kernel = network_avx2;
+#elif defined OUTRO_SORT_X86 && !defined OUTRO_SORT_SIMD_SCALAR
+    if(__builtin_cpu_supports("avx512f"))
+    {
+        kernel = network_avx512;
+    }
+    else if(__builtin_cpu_supports("avx2"))
+    {
+        kernel = network_avx2;
+    }
+#endif
+    if(kernel == NULL || end - begin > 16)
+    {
+        return -1;
+    }
+    kernel(begin, end - begin);
+    return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef TFPF_VERSATILE_SORT_OUTRO_SORT_SIMD_H_
+#define TFPF_VERSATILE_SORT_OUTRO_SORT_SIMD_H_
+
+int *outro_sort_partition_simd(int *, int *, int);
+int outro_sort_network_simd(int *, int *);
+
+#endif  // TFPF_VERSATILE_SORT_OUTRO_SORT_SIMD_H_
@@ -0,0 +1,335 @@
+#if defined OUTRO_SORT_STATS && defined __linux__
+#define _GNU_SOURCE
+#define OUTRO_SORT_PERF
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "outro_sort.h"
+#include "pool.h"
+#include "stats.h"
+
+#ifdef OUTRO_SORT_PERF
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef OUTRO_SORT_STATS
+// Statistics are shared by all threads, but each thread keeps track of its
+// own recursion depth, phases and counter readings.
+#ifdef MULTITHREADED_OUTRO_SORT
+typedef atomic_uint_least64_t Counter;
+#define COUNTER_LOAD(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#define COUNTER_STORE(counter, value) atomic_store_explicit(&(counter), (value), memory_order_relaxed)
+#define COUNTER_ADD(counter, value) atomic_fetch_add_explicit(&(counter), (value), memory_order_relaxed)
+#define THREAD_LOCAL _Thread_local
+#else
+typedef uint_least64_t Counter;
+#define COUNTER_LOAD(counter) (counter)
+#define COUNTER_STORE(counter, value) ((counter) = (value))
+#define COUNTER_ADD(counter, value) ((counter) += (value))
+#define THREAD_LOCAL
+#endif
+
+static struct
+{
+    Counter queued;
+    Counter spawned;
+    Counter inlined;
+    Counter max_depth;
+    Counter counters[OUTRO_SORT_PHASE_COUNT][OUTRO_SORT_COUNTER_COUNT];
+    Counter available_counters;
+} stats;
+
+// Maximum number of nested phases tracked. Deeper phases are not counted.
+#define MAX_PHASES 64
+
+static THREAD_LOCAL struct ThreadStats
+{
+    uint64_t depth;
+    enum OutroSortPhase phases[MAX_PHASES];
+    int num_phases;
+#ifdef OUTRO_SORT_PERF
+    bool opened;
+    int num_events;
+    int fds[OUTRO_SORT_COUNTER_COUNT];
+    enum OutroSortCounter events[OUTRO_SORT_COUNTER_COUNT];
+    uint64_t readings[OUTRO_SORT_COUNTER_COUNT];
+#endif
+} thread_stats;
+
+#ifdef OUTRO_SORT_PERF
+/******************************************************************************
+ * Open a hardware performance counter for the calling thread.
+ *
+ * @param counter Counter.
+ * @param group_fd File descriptor of the group leader, or -1 to open the
+ *     group leader (disabled).
+ *
+ * @return File descriptor, or -1 if the counter is not available.
+ *****************************************************************************/
+static int
+perf_open(enum OutroSortCounter counter, int group_fd)
+{
+    static uint64_t const configs[OUTRO_SORT_COUNTER_COUNT] =
+    {
+        [OUTRO_SORT_COUNTER_CYCLES] = PERF_COUNT_HW_CPU_CYCLES,
+        [OUTRO_SORT_COUNTER_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+        [OUTRO_SORT_COUNTER_BRANCH_MISSES] = PERF_COUNT_HW_BRANCH_MISSES,
+        [OUTRO_SORT_COUNTER_LLC_MISSES] = PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+    };
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = counter == OUTRO_SORT_COUNTER_LLC_MISSES ? PERF_TYPE_HW_CACHE : PERF_TYPE_HARDWARE;
+    attr.config = configs[counter];
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+/******************************************************************************
+ * Close the counters of a thread.
+ *
+ * @param ts_ Statistics of the thread.
+ *****************************************************************************/
+static void
+perf_close(void *ts_)
+{
+    struct ThreadStats *ts = ts_;
+    for(int i = 0; i < ts->num_events; ++i)
+    {
+        close(ts->fds[i]);
+    }
+    ts->num_events = 0;
+}
+
+#ifdef MULTITHREADED_OUTRO_SORT
+// Closes the counters of a thread when it exits.
+static tss_t perf_key;
+static once_flag perf_key_once = ONCE_FLAG_INIT;
+
+static void
+perf_key_create(void)
+{
+    tss_create(&perf_key, perf_close);
+}
+#endif
+
+/******************************************************************************
+ * Open all available counters for the calling thread as a group, so that they
+ * can be read at once. Cycles must be available for any of them to be used.
+ *
+ * @param ts Statistics of the calling thread.
+ *****************************************************************************/
+static void
+perf_open_all(struct ThreadStats *ts)
+{
+    ts->opened = true;
+    ts->num_events = 0;
+    unsigned available = 0;
+    for(int counter = 0; counter < OUTRO_SORT_COUNTER_COUNT; ++counter)
+    {
+        int fd = perf_open(counter, ts->num_events == 0 ? -1 : ts->fds[0]);
+        if(fd == -1)
+        {
+            if(counter == OUTRO_SORT_COUNTER_CYCLES)
+            {
+                return;
+            }
+            continue;
+        }
+        ts->fds[ts->num_events] = fd;
+        ts->events[ts->num_events] = counter;
+        ts->readings[ts->num_events++] = 0;
+        available |= 1U << counter;
+    }
+    if(ioctl(ts->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1)
+    {
+        perf_close(ts);
+        return;
+    }
+#ifdef MULTITHREADED_OUTRO_SORT
+    atomic_fetch_or_explicit(&stats.available_counters, available, memory_order_relaxed);
+    call_once(&perf_key_once, perf_key_create);
+    tss_set(perf_key, ts);
+#else
+    stats.available_counters |= available;
+#endif
+}
+#endif
+
+/******************************************************************************
+ * Read the counters of the calling thread, and attribute the events since
+ * they were last read to its innermost phase.
+ *
+ * @param ts Statistics of the calling thread.
+ *****************************************************************************/
+static void
+sample(struct ThreadStats *ts)
+{
+#ifdef OUTRO_SORT_PERF
+    if(!ts->opened)
+    {
+        perf_open_all(ts);
+    }
+    if(ts->num_events == 0)
+    {
+        return;
+    }
+    uint64_t values[1 + OUTRO_SORT_COUNTER_COUNT];
+    if(read(ts->fds[0], values, sizeof values) < (ssize_t)((1 + ts->num_events) * sizeof *values))
+    {
+        return;
+    }
+    bool attribute = ts->num_phases > 0 && ts->num_phases <= MAX_PHASES;
+    for(int i = 0; i < ts->num_events; ++i)
+    {
+        if(attribute)
+        {
+            COUNTER_ADD(stats.counters[ts->phases[ts->num_phases - 1]][ts->events[i]], values[1 + i] - ts->readings[i]);
+        }
+        ts->readings[i] = values[1 + i];
+    }
+#else
+    (void)ts;
+#endif
+}
+
+/******************************************************************************
+ * Mark the beginning of a phase in the calling thread.
+ *
+ * @param phase Phase.
+ *****************************************************************************/
+void
+outro_sort_stats_begin(enum OutroSortPhase phase)
+{
+    struct ThreadStats *ts = &thread_stats;
+    sample(ts);
+    if(ts->num_phases < MAX_PHASES)
+    {
+        ts->phases[ts->num_phases] = phase;
+    }
+    ++ts->num_phases;
+}
+
+/******************************************************************************
+ * Mark the end of the innermost phase in the calling thread.
+ *****************************************************************************/
+void
+outro_sort_stats_end(void)
+{
+    struct ThreadStats *ts = &thread_stats;
+    sample(ts);
+    --ts->num_phases;
+}
+
+/******************************************************************************
+ * Mark the beginning of a recursive call in the calling thread.
+ *****************************************************************************/
+void
+outro_sort_stats_enter(void)
+{
+    uint64_t depth = ++thread_stats.depth;
+#ifdef MULTITHREADED_OUTRO_SORT
+    uint64_t max_depth = atomic_load_explicit(&stats.max_depth, memory_order_relaxed);
+    while(max_depth < depth && !atomic_compare_exchange_weak_explicit(&stats.max_depth, &max_depth, depth, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+#else
+    if(stats.max_depth < depth)
+    {
+        stats.max_depth = depth;
+    }
+#endif
+}
+
+/******************************************************************************
+ * Mark the end of a recursive call in the calling thread.
+ *****************************************************************************/
+void
+outro_sort_stats_leave(void)
+{
+    --thread_stats.depth;
+}
+
+/******************************************************************************
+ * Count an attempt to sort a subarray in another thread.
+ *
+ * @param wstatus Value returned by `outro_sort_dispatch`.
+ *****************************************************************************/
+void
+outro_sort_stats_dispatched(int wstatus)
+{
+    if(wstatus > 0)
+    {
+        COUNTER_ADD(stats.queued, 1);
+    }
+    else if(wstatus == 0)
+    {
+        COUNTER_ADD(stats.spawned, 1);
+    }
+    else
+    {
+        COUNTER_ADD(stats.inlined, 1);
+    }
+}
+#endif
+
+/******************************************************************************
+ * Obtain the statistics accumulated since they were last reset.
+ *
+ * @param stats_ Statistics to fill in.
+ *
+ * @return 0 if statistics are collected, else -1.
+ *****************************************************************************/
+int
+outro_sort_stats(struct OutroSortStats *stats_)
+{
+#ifdef OUTRO_SORT_STATS
+    stats_->queued = COUNTER_LOAD(stats.queued);
+    stats_->spawned = COUNTER_LOAD(stats.spawned);
+    stats_->inlined = COUNTER_LOAD(stats.inlined);
+    stats_->max_depth = COUNTER_LOAD(stats.max_depth);
+    for(int phase = 0; phase < OUTRO_SORT_PHASE_COUNT; ++phase)
+    {
+        for(int counter = 0; counter < OUTRO_SORT_COUNTER_COUNT; ++counter)
+        {
+            stats_->counters[phase][counter] = COUNTER_LOAD(stats.counters[phase][counter]);
+        }
+    }
+    stats_->available_counters = COUNTER_LOAD(stats.available_counters);
+    return 0;
+#else
+    memset(stats_, 0, sizeof *stats_);
+    return -1;
+#endif
+}
+
+/******************************************************************************
+ * Reset the statistics. Whether counters are available is remembered. This
+ * function must not be called while a sort is in progress.
+ *****************************************************************************/
+void
+outro_sort_stats_reset(void)
+{
+#ifdef OUTRO_SORT_STATS
+    COUNTER_STORE(stats.queued, 0);
+    COUNTER_STORE(stats.spawned, 0);
+    COUNTER_STORE(stats.inlined, 0);
+    COUNTER_STORE(stats.max_depth, 0);
+    for(int phase = 0; phase < OUTRO_SORT_PHASE_COUNT; ++phase)
+    {
+        for(int counter = 0; counter < OUTRO_SORT_COUNTER_COUNT; ++counter)
+        {
+            COUNTER_STORE(stats.counters[phase][counter], 0);
+        }
+    }
+#endif
+}
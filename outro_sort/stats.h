@@ -0,0 +1,44 @@
+#ifndef TFPF_VERSATILE_SORT_OUTRO_SORT_STATS_H_
+#define TFPF_VERSATILE_SORT_OUTRO_SORT_STATS_H_
+
+#include "outro_sort.h"
+
+// Hooks called by the sort functions to collect statistics. Unless the
+// library is built with `OUTRO_SORT_STATS`, they do nothing, and are
+// optimised away.
+#ifdef OUTRO_SORT_STATS
+void outro_sort_stats_begin(enum OutroSortPhase);
+void outro_sort_stats_end(void);
+void outro_sort_stats_enter(void);
+void outro_sort_stats_leave(void);
+void outro_sort_stats_dispatched(int);
+#else
+static inline void
+outro_sort_stats_begin(enum OutroSortPhase phase)
+{
+    (void)phase;
+}
+
+static inline void
+outro_sort_stats_end(void)
+{
+}
+
+static inline void
+outro_sort_stats_enter(void)
+{
+}
+
+static inline void
+outro_sort_stats_leave(void)
+{
+}
+
+static inline void
+outro_sort_stats_dispatched(int wstatus)
+{
+    (void)wstatus;
+}
+#endif
+
+#endif  // TFPF_VERSATILE_SORT_OUTRO_SORT_STATS_H_
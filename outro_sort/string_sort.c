@@ -0,0 +1,544 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "outro_sort.h"
+#include "pool.h"
+#include "stats.h"
+
+// Minimum number of keys each thread should pack or unpack.
+#define CHUNK_SIZE 65536U
+
+// Maximum number of keys which are sorted using insertion sort.
+#define STRING_LEAF_SIZE 16
+
+// Number of bytes of a key cached next to its index.
+#define PREFIX_BYTES 8
+
+// Key being sorted: the bytes at the current depth, packed so that comparing
+// them as integers compares them lexicographically (missing bytes are zeros),
+// and the number of bytes left from the current depth.
+struct StringKey
+{
+    uint64_t prefix;
+    size_t remaining;
+    size_t index;
+};
+
+// Keys shared by all threads working on a sort: either strings or byte keys,
+// and their sizes.
+struct StringSort
+{
+    char const *const *strings;
+    void const *const *bytes;
+    size_t const *sizes;
+};
+
+// Part of an array of keys sorted by one thread, all of whose keys have the
+// same first `depth` bytes.
+struct StringTask
+{
+    struct StringSort const *sort;
+    struct StringKey *keys;
+    size_t num_keys;
+    size_t depth;
+};
+
+// Part of an array of keys packed or unpacked by one thread.
+struct StringChunk
+{
+    // Either strings or byte keys with their sizes.
+    char const *const *strings;
+    void const *const *bytes;
+    size_t const *sizes;
+
+    // Lengths of the strings, to fill in.
+    size_t *lengths;
+
+    struct StringKey *keys;
+    size_t *permutation;
+    char const **sorted;
+    size_t begin;
+    size_t end;
+};
+
+/******************************************************************************
+ * Read up to 8 bytes of a key as a big-endian integer, padded with zeros.
+ *
+ * @param bytes Pointer to the first byte to read.
+ * @param remaining Number of bytes of the key from there.
+ *
+ * @return Prefix.
+ *****************************************************************************/
+static inline uint64_t
+load_prefix(unsigned char const *bytes, size_t remaining)
+{
+    uint64_t prefix = 0;
+    if(remaining >= PREFIX_BYTES)
+    {
+#if defined __GNUC__ && defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(&prefix, bytes, PREFIX_BYTES);
+        return __builtin_bswap64(prefix);
+#else
+        remaining = PREFIX_BYTES;
+#endif
+    }
+    for(size_t i = 0; i < remaining; ++i)
+    {
+        prefix |= (uint64_t)bytes[i] << (PREFIX_BYTES - 1 - i) * 8;
+    }
+    return prefix;
+}
+
+/******************************************************************************
+ * Obtain the bytes of a key.
+ *
+ * @param sort
+ * @param index Index of the key.
+ *
+ * @return Pointer to the first byte.
+ *****************************************************************************/
+static inline unsigned char const *
+key_bytes(struct StringSort const *sort, size_t index)
+{
+    return sort->strings != NULL ? (unsigned char const *)sort->strings[index] : sort->bytes[index];
+}
+
+/******************************************************************************
+ * Set the prefix of a key at a depth.
+ *
+ * @param sort
+ * @param key
+ * @param depth Number of bytes to skip.
+ *****************************************************************************/
+static inline void
+set_prefix(struct StringSort const *sort, struct StringKey *key, size_t depth)
+{
+    size_t size = sort->sizes[key->index];
+    key->remaining = size > depth ? size - depth : 0;
+    key->prefix = load_prefix(key_bytes(sort, key->index) + depth, key->remaining);
+}
+
+/******************************************************************************
+ * Number of bytes left in a key, with all keys which continue beyond their
+ * prefix treated alike. Comparing the prefixes and then these orders keys
+ * exactly, except for keys which are equal in both and continue.
+ *
+ * @param key
+ *
+ * @return Number of bytes left, at most 9.
+ *****************************************************************************/
+static inline size_t
+clamped(struct StringKey const *key)
+{
+    return key->remaining > PREFIX_BYTES ? PREFIX_BYTES + 1 : key->remaining;
+}
+
+/******************************************************************************
+ * Compare two keys by their prefixes.
+ *
+ * @param a
+ * @param b
+ *
+ * @return Negative, zero or positive as `a` is less than, equivalent to or
+ *     greater than `b` in its prefix.
+ *****************************************************************************/
+static inline int
+compare_prefix(struct StringKey const *a, struct StringKey const *b)
+{
+    if(a->prefix != b->prefix)
+    {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    return (int)clamped(a) - (int)clamped(b);
+}
+
+/******************************************************************************
+ * Compare two keys completely, starting at a depth.
+ *
+ * @param sort
+ * @param a
+ * @param b
+ * @param depth Number of bytes already known to be equal.
+ *
+ * @return Negative, zero or positive as `a` is less than, equal to or greater
+ *     than `b`.
+ *****************************************************************************/
+static int
+compare_keys(struct StringSort const *sort, struct StringKey const *a, struct StringKey const *b, size_t depth)
+{
+    int result = compare_prefix(a, b);
+    if(result != 0 || a->remaining <= PREFIX_BYTES)
+    {
+        return result;
+    }
+    size_t offset = depth + PREFIX_BYTES;
+    size_t a_size = a->remaining - PREFIX_BYTES, b_size = b->remaining - PREFIX_BYTES;
+    result = memcmp(key_bytes(sort, a->index) + offset, key_bytes(sort, b->index) + offset, a_size < b_size ? a_size : b_size);
+    if(result != 0)
+    {
+        return result;
+    }
+    return a_size < b_size ? -1 : a_size > b_size;
+}
+
+/******************************************************************************
+ * Sort keys using insertion sort.
+ *
+ * @param sort
+ * @param keys
+ * @param num_keys
+ * @param depth Number of bytes all keys have in common.
+ *****************************************************************************/
+static void
+string_insertion_sort(struct StringSort const *sort, struct StringKey *keys, size_t num_keys, size_t depth)
+{
+    for(size_t i = 1; i < num_keys; ++i)
+    {
+        struct StringKey key = keys[i];
+        size_t j = i;
+        for(; j > 0 && compare_keys(sort, &key, keys + j - 1, depth) < 0; --j)
+        {
+            keys[j] = keys[j - 1];
+        }
+        keys[j] = key;
+    }
+}
+
+/******************************************************************************
+ * Choose the key whose prefix is the median of those of three keys.
+ *
+ * @param a
+ * @param b
+ * @param c
+ *
+ * @return Median.
+ *****************************************************************************/
+static struct StringKey const *
+median_of_three(struct StringKey const *a, struct StringKey const *b, struct StringKey const *c)
+{
+    if(compare_prefix(a, b) < 0)
+    {
+        return compare_prefix(b, c) < 0 ? b : compare_prefix(a, c) < 0 ? c : a;
+    }
+    return compare_prefix(a, c) < 0 ? a : compare_prefix(b, c) < 0 ? c : b;
+}
+
+/******************************************************************************
+ * Choose a pivot: the median of three keys, or (for large arrays) the median
+ * of the medians of three groups of three.
+ *
+ * @param keys
+ * @param num_keys
+ *
+ * @return Pivot.
+ *****************************************************************************/
+static struct StringKey
+choose_pivot(struct StringKey const *keys, size_t num_keys)
+{
+    size_t last = num_keys - 1, middle = num_keys / 2;
+    if(num_keys < 128)
+    {
+        return *median_of_three(keys, keys + middle, keys + last);
+    }
+    size_t step = num_keys / 8;
+    struct StringKey const *low = median_of_three(keys, keys + step, keys + 2 * step);
+    struct StringKey const *mid = median_of_three(keys + middle - step, keys + middle, keys + middle + step);
+    struct StringKey const *high = median_of_three(keys + last - 2 * step, keys + last - step, keys + last);
+    return *median_of_three(low, mid, high);
+}
+
+static void string_sort_loop(struct StringSort const *, struct StringKey *, size_t, size_t);
+
+/******************************************************************************
+ * Helper function to sort keys in a separate thread.
+ *
+ * @param task_ Keys to sort.
+ * @param unused
+ *****************************************************************************/
+static void
+string_sort_task(void *task_, void *unused)
+{
+    (void)unused;
+    struct StringTask *task = task_;
+    string_sort_loop(task->sort, task->keys, task->num_keys, task->depth);
+}
+
+/******************************************************************************
+ * Sort keys using multikey quicksort. The keys are partitioned three ways by
+ * their prefixes: the keys less than and greater than the pivot are sorted at
+ * the same depth, and those equal to it (unless they end there) at the next
+ * depth, for which their prefixes are loaded again. The smaller of the first
+ * two parts is sorted by another thread if possible.
+ *
+ * @param sort
+ * @param keys
+ * @param num_keys
+ * @param depth Number of bytes all keys have in common.
+ *****************************************************************************/
+static void
+string_sort_loop(struct StringSort const *sort, struct StringKey *keys, size_t num_keys, size_t depth)
+{
+    while(num_keys > STRING_LEAF_SIZE)
+    {
+        // Dijkstra's three-way partitioning scheme.
+        outro_sort_stats_begin(OUTRO_SORT_PHASE_PARTITION);
+        struct StringKey pivot = choose_pivot(keys, num_keys);
+        size_t lt = 0, i = 0, gt = num_keys;
+        while(i < gt)
+        {
+            int result = compare_prefix(keys + i, &pivot);
+            if(result < 0)
+            {
+                struct StringKey key = keys[lt];
+                keys[lt++] = keys[i];
+                keys[i++] = key;
+            }
+            else if(result > 0)
+            {
+                struct StringKey key = keys[--gt];
+                keys[gt] = keys[i];
+                keys[i] = key;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        outro_sort_stats_end();
+
+        // Keys which all share the prefix need no recursion.
+        if(lt == 0 && gt == num_keys)
+        {
+            if(pivot.remaining <= PREFIX_BYTES)
+            {
+                return;
+            }
+            depth += PREFIX_BYTES;
+            for(size_t j = 0; j < num_keys; ++j)
+            {
+                set_prefix(sort, keys + j, depth);
+            }
+            continue;
+        }
+
+        struct StringTask small = {sort, keys, lt, depth};
+        struct StringKey *large_keys = keys + gt;
+        size_t large_size = num_keys - gt;
+        if(small.num_keys > large_size)
+        {
+            small.keys = large_keys;
+            small.num_keys = large_size;
+            large_keys = keys;
+            large_size = lt;
+        }
+        struct OutroSortWorker worker;
+        outro_sort_stats_begin(OUTRO_SORT_PHASE_DISPATCH);
+        int wstatus = outro_sort_dispatch(string_sort_task, &small, NULL, small.num_keys, &worker);
+        outro_sort_stats_end();
+        outro_sort_stats_dispatched(wstatus);
+        if(wstatus < 0)
+        {
+            outro_sort_stats_enter();
+            string_sort_loop(sort, small.keys, small.num_keys, depth);
+            outro_sort_stats_leave();
+        }
+        if(pivot.remaining > PREFIX_BYTES)
+        {
+            for(size_t j = lt; j < gt; ++j)
+            {
+                set_prefix(sort, keys + j, depth + PREFIX_BYTES);
+            }
+            outro_sort_stats_enter();
+            string_sort_loop(sort, keys + lt, gt - lt, depth + PREFIX_BYTES);
+            outro_sort_stats_leave();
+        }
+        if(wstatus >= 0)
+        {
+            outro_sort_stats_enter();
+            string_sort_loop(sort, large_keys, large_size, depth);
+            outro_sort_stats_leave();
+            outro_sort_stats_begin(OUTRO_SORT_PHASE_DISPATCH);
+            outro_sort_join(&worker, wstatus);
+            outro_sort_stats_end();
+            return;
+        }
+        keys = large_keys;
+        num_keys = large_size;
+    }
+    outro_sort_stats_begin(OUTRO_SORT_PHASE_LEAF);
+    string_insertion_sort(sort, keys, num_keys, depth);
+    outro_sort_stats_end();
+}
+
+/******************************************************************************
+ * Find the lengths of some strings, and pair their first bytes with their
+ * indices.
+ *
+ * @param chunk_
+ * @param unused
+ *****************************************************************************/
+static void
+pack(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct StringChunk *chunk = chunk_;
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        struct StringKey *key = chunk->keys + i;
+        key->index = i;
+        if(chunk->strings != NULL)
+        {
+            chunk->lengths[i] = strlen(chunk->strings[i]);
+            key->remaining = chunk->lengths[i];
+            key->prefix = load_prefix((unsigned char const *)chunk->strings[i], key->remaining);
+        }
+        else
+        {
+            key->remaining = chunk->sizes[i];
+            key->prefix = load_prefix(chunk->bytes[i], key->remaining);
+        }
+    }
+}
+
+/******************************************************************************
+ * Extract the indices (or the strings they refer to) from sorted keys.
+ *
+ * @param chunk_
+ * @param unused
+ *****************************************************************************/
+static void
+unpack(void *chunk_, void *unused)
+{
+    (void)unused;
+    struct StringChunk *chunk = chunk_;
+    for(size_t i = chunk->begin; i < chunk->end; ++i)
+    {
+        if(chunk->sorted != NULL)
+        {
+            chunk->sorted[i] = chunk->strings[chunk->keys[i].index];
+        }
+        else
+        {
+            chunk->permutation[i] = chunk->keys[i].index;
+        }
+    }
+}
+
+/******************************************************************************
+ * Sort strings or byte keys. Their first bytes are paired with their indices
+ * in a packed array (by multiple threads), which is sorted using multikey
+ * quicksort, so that most comparisons do not touch the keys themselves.
+ *
+ * @param strings Strings, or `NULL` to sort byte keys.
+ * @param bytes Byte keys, or `NULL` to sort strings.
+ * @param sizes Sizes of the byte keys.
+ * @param size Number of strings or keys.
+ * @param permutation Array to write the indices to, or `NULL`.
+ * @param sorted Array to write the sorted strings to, or `NULL`.
+ *
+ * @return 0 if the indices or strings were written, else -1, in which case
+ *     memory could not be allocated, and nothing was written.
+ *****************************************************************************/
+static int
+sort_strings(char const *const *strings, void const *const *bytes, size_t const *sizes, size_t size, size_t *permutation, char const **sorted)
+{
+    struct StringKey *keys = malloc(size * sizeof *keys);
+    size_t *lengths = strings != NULL ? malloc(size * sizeof *lengths) : NULL;
+    if(keys == NULL || (strings != NULL && lengths == NULL))
+    {
+        free(lengths);
+        free(keys);
+        return size == 0 ? 0 : -1;
+    }
+    int num_chunks = outro_sort_num_chunks(size, CHUNK_SIZE);
+    struct StringChunk chunks[OUTRO_SORT_RUN_MAX];
+    for(int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].strings = strings;
+        chunks[i].bytes = bytes;
+        chunks[i].sizes = sizes;
+        chunks[i].lengths = lengths;
+        chunks[i].keys = keys;
+        chunks[i].permutation = permutation;
+        chunks[i].sorted = sorted;
+        chunks[i].begin = size * i / num_chunks;
+        chunks[i].end = size * (i + 1) / num_chunks;
+    }
+    outro_sort_run(pack, chunks, sizeof *chunks, num_chunks, size / num_chunks);
+    struct StringSort sort;
+    sort.strings = strings;
+    sort.bytes = bytes;
+    sort.sizes = strings != NULL ? lengths : sizes;
+    string_sort_loop(&sort, keys, size, 0);
+    outro_sort_run(unpack, chunks, sizeof *chunks, num_chunks, size / num_chunks);
+    free(lengths);
+    free(keys);
+    return 0;
+}
+
+/******************************************************************************
+ * Sort strings in lexicographic order of their bytes (as `strcmp` compares
+ * them).
+ *
+ * @param strings Pointer to the first string.
+ * @param num_strings Number of strings.
+ *
+ * @return 0 if the strings were sorted, else -1, in which case memory could
+ *     not be allocated, and the strings are unchanged.
+ *****************************************************************************/
+int
+outro_sort_strings(char const **strings, size_t num_strings)
+{
+    char const **sorted = malloc(num_strings * sizeof *sorted);
+    if(sorted == NULL && num_strings > 0)
+    {
+        return -1;
+    }
+    int status = sort_strings(strings, NULL, NULL, num_strings, NULL, sorted);
+    if(status == 0 && num_strings > 0)
+    {
+        memcpy(strings, sorted, num_strings * sizeof *strings);
+    }
+    free(sorted);
+    return status;
+}
+
+/******************************************************************************
+ * Find the order in which strings would be if they were sorted, without moving
+ * them. The order of equal strings is unspecified.
+ *
+ * @param strings Pointer to the first string.
+ * @param num_strings Number of strings.
+ * @param permutation Array to write the index of the string which would be at
+ *     each position to.
+ *
+ * @return 0 if the permutation was written, else -1, in which case memory
+ *     could not be allocated.
+ *****************************************************************************/
+int
+outro_argsort_strings(char const *const *strings, size_t num_strings, size_t *permutation)
+{
+    return sort_strings(strings, NULL, NULL, num_strings, permutation, NULL);
+}
+
+/******************************************************************************
+ * Find the order in which byte keys (which may contain null bytes) would be if
+ * they were sorted lexicographically, without moving them. A key which is a
+ * prefix of another is less than it. The order of equal keys is unspecified.
+ *
+ * @param keys Pointer to the first key.
+ * @param sizes Sizes of the keys.
+ * @param num_keys Number of keys.
+ * @param permutation Array to write the index of the key which would be at
+ *     each position to.
+ *
+ * @return 0 if the permutation was written, else -1, in which case memory
+ *     could not be allocated.
+ *****************************************************************************/
+int
+outro_argsort_bytes(void const *const *keys, size_t const *sizes, size_t num_keys, size_t *permutation)
+{
+    return sort_strings(NULL, keys, sizes, num_keys, permutation, NULL);
+}
@@ -2,26 +2,70 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "outro_sort.h"
 
 #define ITERATIONS 16
 
+// Distributions of the values the arrays are populated with.
+enum Fill
+{
+    FILL_RANDOM,
+    FILL_SORTED,
+    FILL_REVERSED,
+    FILL_NEARLY_SORTED,
+    FILL_ORGAN_PIPE,
+    FILL_FEW_UNIQUE,
+    FILL_CONSTANT,
+    FILL_COUNT,
+};
+
+char const *fill_names[] = {
+    "random", "sorted", "reversed", "nearly sorted", "organ pipe", "few unique", "constant",
+};
+
 /******************************************************************************
- * Populate the array with random values.
+ * Populate the array with values.
  *
  * @param begin Pointer to the first element.
  * @param end Pointer to one past the last element.
+ * @param mode Distribution of the values.
  *****************************************************************************/
 void
-fill(int *begin, int *end)
+fill(int *begin, int *end, enum Fill mode)
 {
-    for(int *curr = begin; curr < end; ++curr)
+    int size = end - begin;
+    for(int i = 0; i < size; ++i)
     {
-        *curr = rand();
+        switch(mode)
+        {
+            case FILL_RANDOM:
+                begin[i] = rand();
+                break;
+            case FILL_SORTED:
+                begin[i] = i;
+                break;
+            case FILL_REVERSED:
+                begin[i] = size - i;
+                break;
+            case FILL_NEARLY_SORTED:
+                begin[i] = rand() % 100 == 0 ? rand() % size : i;
+                break;
+            case FILL_ORGAN_PIPE:
+                begin[i] = i < size / 2 ? i : size - i;
+                break;
+            case FILL_FEW_UNIQUE:
+                begin[i] = rand() % 16;
+                break;
+            default:
+                begin[i] = 42;
+                break;
+        }
     }
 }
 
@@ -50,36 +94,598 @@ void
 test(void (*sorter)(int *, int *), size_t arr_size)
 {
     int *arr = malloc(arr_size * sizeof *arr);
-    fill(arr, arr + arr_size);
-    sorter(arr, arr + arr_size);
+    for(enum Fill mode = FILL_RANDOM; mode < FILL_COUNT; ++mode)
+    {
+        fill(arr, arr + arr_size, mode);
+        sorter(arr, arr + arr_size);
+        verify(arr, arr + arr_size);
+    }
+    free(arr);
+}
+
+/******************************************************************************
+ * Check whether the sort function generated for an element type works
+ * correctly.
+ *
+ * @param type Element type.
+ * @param suffix Suffix of the sort function.
+ * @param expr Expression which evaluates to a random element.
+ * @param arr_size Number of elements to sort.
+ *****************************************************************************/
+#define TEST_TYPED(type, suffix, expr, arr_size)  \
+    do  \
+    {  \
+        type *arr = malloc((arr_size) * sizeof *arr);  \
+        for(size_t i = 0; i < (arr_size); ++i)  \
+        {  \
+            arr[i] = (expr);  \
+        }  \
+        outro_sort##suffix(arr, arr + (arr_size));  \
+        for(size_t i = 1; i < (arr_size); ++i)  \
+        {  \
+            assert(!(arr[i] < arr[i - 1]));  \
+        }  \
+        free(arr);  \
+    }  \
+    while(0)
+
+/******************************************************************************
+ * Check whether the sort functions for all element types work correctly.
+ *
+ * @param arr_size Number of elements to sort.
+ *****************************************************************************/
+void
+test_types(size_t arr_size)
+{
+    TEST_TYPED(int64_t, _i64, (int64_t)rand() * rand() - RAND_MAX, arr_size);
+    TEST_TYPED(uint32_t, _u32, (uint32_t)rand() * rand(), arr_size);
+    TEST_TYPED(uint64_t, _u64, (uint64_t)rand() * rand() * rand(), arr_size);
+    TEST_TYPED(double, _f64, (double)rand() / rand() - 1.0, arr_size);
+
+    // Records must be moved as a whole.
+    struct OutroSortRecord *arr = malloc(arr_size * sizeof *arr);
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        arr[i].key = rand() % 1024 - 512;
+        arr[i].value = ~arr[i].key;
+    }
+    outro_sort_rec(arr, arr + arr_size);
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        assert(i == 0 || arr[i - 1].key <= arr[i].key);
+        assert(arr[i].value == ~arr[i].key);
+    }
+    free(arr);
+}
+
+/******************************************************************************
+ * Check whether stable sorting works correctly, and keeps records with equal
+ * keys in their original order.
+ *
+ * @param arr_size Number of elements to sort.
+ *****************************************************************************/
+void
+test_stable(size_t arr_size)
+{
+    int *keys = malloc(arr_size * sizeof *keys);
+    struct OutroSortRecord *arr = malloc(arr_size * sizeof *arr);
+    for(enum Fill mode = FILL_RANDOM; mode < FILL_COUNT; ++mode)
+    {
+        fill(keys, keys + arr_size, mode);
+        for(size_t i = 0; i < arr_size; ++i)
+        {
+            // Few unique keys, so that there are many ties.
+            arr[i].key = mode == FILL_RANDOM ? keys[i] % 1024 : keys[i];
+            arr[i].value = i;
+        }
+        int status = stable_sort_rec(arr, arr + arr_size);
+        assert(status == 0);
+        (void)status;
+        for(size_t i = 0; i < arr_size; ++i)
+        {
+            assert(arr[i].key == (mode == FILL_RANDOM ? keys[arr[i].value] % 1024 : keys[arr[i].value]));
+            assert(i == 0 || arr[i - 1].key < arr[i].key || (arr[i - 1].key == arr[i].key && arr[i - 1].value < arr[i].value));
+        }
+    }
+    free(arr);
+    free(keys);
+}
+
+/******************************************************************************
+ * Check whether asynchronous sorts work correctly, and whether cancelled ones
+ * leave a permutation of the original contents.
+ *
+ * @param arr_size Number of elements to sort in each array.
+ * @param pool Whether the thread pool is running.
+ *****************************************************************************/
+void
+test_async(size_t arr_size, int pool)
+{
+    enum { NUM_JOBS = 4 };
+    int *arrs[NUM_JOBS], *sorted[NUM_JOBS];
+    struct OutroSortJob *jobs[NUM_JOBS];
+    for(int i = 0; i < NUM_JOBS; ++i)
+    {
+        arrs[i] = malloc(arr_size * sizeof *arrs[i]);
+        sorted[i] = malloc(arr_size * sizeof *sorted[i]);
+        fill(arrs[i], arrs[i] + arr_size, FILL_RANDOM);
+        int submitted = outro_sort_submit(arrs[i], arrs[i] + arr_size, jobs + i);
+        assert(submitted == 0);
+        (void)submitted;
+    }
+    for(int i = 0; i < NUM_JOBS; ++i)
+    {
+        while(!outro_sort_poll(jobs[i]))
+        {
+        }
+        int waited = outro_sort_wait(jobs[i]);
+        assert(waited == 0);
+        (void)waited;
+        verify(arrs[i], arrs[i] + arr_size);
+    }
+
+    // Without the pool and with no thread to spare, sorts cannot be started
+    // (unless multithreading is not supported, in which case they are already
+    // done). Once a thread is available again, they run without being waited
+    // for.
+    if(!pool)
+    {
+        outro_sort_configure(1, 32768U);
+        fill(arrs[0], arrs[0] + arr_size, FILL_RANDOM);
+        int submitted = outro_sort_submit(arrs[0], arrs[0] + arr_size, jobs);
+        assert(submitted == -1 || outro_sort_poll(jobs[0]));
+        if(submitted == 0)
+        {
+            int waited = outro_sort_wait(jobs[0]);
+            assert(waited == 0);
+            (void)waited;
+        }
+        outro_sort_configure(2, 32768U);
+        fill(arrs[0], arrs[0] + arr_size, FILL_RANDOM);
+        submitted = outro_sort_submit(arrs[0], arrs[0] + arr_size, jobs);
+        assert(submitted == 0);
+        while(!outro_sort_poll(jobs[0]))
+        {
+        }
+        int waited = outro_sort_wait(jobs[0]);
+        assert(waited == 0);
+        verify(arrs[0], arrs[0] + arr_size);
+        outro_sort_configure(32, 32768U);
+        (void)submitted;
+        (void)waited;
+    }
+
+    // Sorts cancelled straight away may not even start.
+    for(int i = 0; i < NUM_JOBS; ++i)
+    {
+        fill(arrs[i], arrs[i] + arr_size, FILL_RANDOM);
+        memcpy(sorted[i], arrs[i], arr_size * sizeof *sorted[i]);
+        outro_sort(sorted[i], sorted[i] + arr_size);
+    }
+    for(int i = 0; i < NUM_JOBS; ++i)
+    {
+        int submitted = outro_sort_submit(arrs[i], arrs[i] + arr_size, jobs + i);
+        assert(submitted == 0);
+        (void)submitted;
+    }
+    for(int i = NUM_JOBS - 1; i >= 0; --i)
+    {
+        outro_sort_cancel(jobs[i]);
+    }
+    for(int i = 0; i < NUM_JOBS; ++i)
+    {
+        if(outro_sort_wait(jobs[i]) != 0)
+        {
+            outro_sort(arrs[i], arrs[i] + arr_size);
+        }
+        assert(memcmp(arrs[i], sorted[i], arr_size * sizeof *arrs[i]) == 0);
+        free(sorted[i]);
+        free(arrs[i]);
+    }
+}
+
+/******************************************************************************
+ * Check whether sorting with a context works correctly, uses its settings
+ * instead of the global ones, and counts the subarrays dispatched.
+ *
+ * @param arr_size Number of elements to sort.
+ *****************************************************************************/
+void
+test_context(size_t arr_size)
+{
+    int *arr = malloc(arr_size * sizeof *arr);
+    int *scratch = malloc(arr_size * sizeof *scratch);
+
+    // A single thread with a small leaf size: everything is sorted inline.
+    struct OutroSortContext ctx;
+    outro_sort_context_init(&ctx);
+    assert(ctx.max_threads >= 1);
+    ctx.max_threads = 1;
+    ctx.leaf_size = 5;
+    ctx.radix_threshold = 0;
+    fill(arr, arr + arr_size, FILL_RANDOM);
+    outro_sort_ctx(&ctx, arr, arr + arr_size);
+    verify(arr, arr + arr_size);
+    assert(ctx.stats.queued == 0 && ctx.stats.spawned == 0);
+    assert(arr_size < 64 || ctx.stats.inlined > 0);
+
+    // Radix sort using the scratch memory instead of allocating a buffer.
+    outro_sort_context_init(&ctx);
+    ctx.radix_threshold = 1;
+    ctx.scratch = scratch;
+    ctx.scratch_size = arr_size * sizeof *scratch;
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        scratch[i] = -1;
+    }
+    fill(arr, arr + arr_size, FILL_RANDOM);
+    outro_sort_ctx(&ctx, arr, arr + arr_size);
     verify(arr, arr + arr_size);
+    int scratch_used = 0;
+    for(size_t i = 0; i < arr_size && !scratch_used; ++i)
+    {
+        scratch_used = scratch[i] != -1;
+    }
+    assert(arr_size <= ctx.leaf_size || scratch_used);
+    free(scratch);
     free(arr);
 }
 
+/******************************************************************************
+ * Check whether profiles are saved and loaded correctly, and whether tuning
+ * finds settings which sort correctly.
+ *
+ * @param arr_size Number of elements to sort.
+ *****************************************************************************/
+void
+test_profile(size_t arr_size)
+{
+    char const *path = "test.profile";
+    struct OutroSortContext ctx, loaded;
+    outro_sort_context_init(&ctx);
+    ctx.max_threads = 3;
+    ctx.multithreading_threshold = 12345;
+    ctx.radix_threshold = 0;
+    ctx.partition = OUTRO_SORT_PARTITION_HOARE;
+    ctx.mode = OUTRO_SORT_MODE_SAMPLE;
+    ctx.parallel_partition_threshold = 54321;
+    ctx.leaf_size = 7;
+    int status = outro_sort_profile_save(&ctx, path);
+    assert(status == 0);
+    outro_sort_context_init(&loaded);
+    status = outro_sort_profile_load(&loaded, path);
+    assert(status == 0);
+    assert(loaded.max_threads == 3 && loaded.multithreading_threshold == 12345 && loaded.radix_threshold == 0);
+    assert(loaded.partition == OUTRO_SORT_PARTITION_HOARE && loaded.mode == OUTRO_SORT_MODE_SAMPLE);
+    assert(loaded.parallel_partition_threshold == 54321 && loaded.leaf_size == 7);
+
+    // An invalid value leaves the context unchanged.
+    FILE *profile = fopen(path, "a");
+    fprintf(profile, "leaf_size 2\n");
+    fclose(profile);
+    outro_sort_context_init(&loaded);
+    size_t leaf_size = loaded.leaf_size;
+    status = outro_sort_profile_load(&loaded, path);
+    assert(status == -1);
+    assert(loaded.leaf_size == leaf_size && loaded.max_threads != 3);
+    (void)leaf_size;
+    remove(path);
+
+    size_t tune_size = arr_size < 65536 ? arr_size : 65536;
+    status = outro_sort_tune(&ctx, tune_size, 42);
+    assert(status == 0);
+    (void)status;
+    assert(ctx.max_threads >= 1 && ctx.leaf_size >= 3);
+    int *arr = malloc(arr_size * sizeof *arr);
+    fill(arr, arr + arr_size, FILL_RANDOM);
+    outro_sort_ctx(&ctx, arr, arr + arr_size);
+    verify(arr, arr + arr_size);
+    free(arr);
+}
+
+// Byte key which may contain null bytes.
+struct ByteKey
+{
+    unsigned char const *bytes;
+    size_t size;
+};
+
+int
+compare_strings(void const *a, void const *b)
+{
+    return strcmp(*(char const *const *)a, *(char const *const *)b);
+}
+
+int
+compare_byte_keys(struct ByteKey const *a, struct ByteKey const *b)
+{
+    int result = memcmp(a->bytes, b->bytes, a->size < b->size ? a->size : b->size);
+    return result != 0 ? result : (a->size > b->size) - (a->size < b->size);
+}
+
+/******************************************************************************
+ * Check whether sorting strings and byte keys works correctly. The keys have
+ * long common prefixes, many duplicates and various lengths (including 0).
+ *
+ * @param arr_size Number of strings.
+ *****************************************************************************/
+void
+test_strings(size_t arr_size)
+{
+    enum { MAX_LENGTH = 40 };
+    char *storage = malloc(arr_size * (MAX_LENGTH + 1));
+    char const **strings = malloc(arr_size * sizeof *strings);
+    char const **expected = malloc(arr_size * sizeof *expected);
+    size_t *permutation = malloc(arr_size * sizeof *permutation);
+    void const **bytes = malloc(arr_size * sizeof *bytes);
+    size_t *sizes = malloc(arr_size * sizeof *sizes);
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        char *string = storage + i * (MAX_LENGTH + 1);
+        size_t length = rand() % (MAX_LENGTH + 1), prefix_length = rand() % 3 * 12;
+        for(size_t j = 0; j < length; ++j)
+        {
+            string[j] = j < prefix_length ? "http://a.example/"[j % 17] : "ab/c"[rand() % 4];
+        }
+        string[length] = '\0';
+        strings[i] = string;
+
+        // Byte keys differ only in trailing null bytes, if at all.
+        bytes[i] = string;
+        sizes[i] = length + (length < MAX_LENGTH ? rand() % 2 : 0);
+    }
+    memcpy(expected, strings, arr_size * sizeof *expected);
+    qsort(expected, arr_size, sizeof *expected, compare_strings);
+
+    int status = outro_argsort_strings(strings, arr_size, permutation);
+    assert(status == 0);
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        assert(strcmp(strings[permutation[i]], expected[i]) == 0);
+    }
+    status = outro_argsort_bytes(bytes, sizes, arr_size, permutation);
+    assert(status == 0);
+    for(size_t i = 1; i < arr_size; ++i)
+    {
+        struct ByteKey a = {bytes[permutation[i - 1]], sizes[permutation[i - 1]]};
+        struct ByteKey b = {bytes[permutation[i]], sizes[permutation[i]]};
+        assert(compare_byte_keys(&a, &b) <= 0);
+        (void)a;
+        (void)b;
+    }
+    status = outro_sort_strings(strings, arr_size);
+    assert(status == 0);
+    (void)status;
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        assert(strcmp(strings[i], expected[i]) == 0);
+    }
+    free(sizes);
+    free(bytes);
+    free(permutation);
+    free(expected);
+    free(strings);
+    free(storage);
+}
+
+// Record too large to be moved around while sorting.
+struct WideRecord
+{
+    int64_t key;
+    int64_t payload[7];
+};
+
+int64_t
+wide_record_key(void const *record)
+{
+    return ((struct WideRecord const *)record)->key;
+}
+
+/******************************************************************************
+ * Check whether sorting indices of and pointers to records, and rearranging
+ * records according to a permutation, work correctly.
+ *
+ * @param arr_size Number of records.
+ *****************************************************************************/
+void
+test_argsort(size_t arr_size)
+{
+    struct WideRecord *arr = malloc(arr_size * sizeof *arr);
+    struct WideRecord *expected = malloc(arr_size * sizeof *expected);
+    void const **pointers = malloc(arr_size * sizeof *pointers);
+    size_t *permutation = malloc(arr_size * sizeof *permutation);
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        arr[i].key = rand() % 1024;
+        for(int j = 0; j < 7; ++j)
+        {
+            arr[i].payload[j] = arr[i].key * 7 + j;
+        }
+    }
+
+    int status = outro_argsort(arr, arr_size, sizeof *arr, wide_record_key, permutation);
+    assert(status == 0);
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        expected[i] = arr[permutation[i]];
+        assert(i == 0 || expected[i - 1].key <= expected[i].key);
+    }
+    status = outro_apply_permutation(arr, arr_size, sizeof *arr, permutation);
+    assert(status == 0);
+    assert(memcmp(arr, expected, arr_size * sizeof *arr) == 0);
+
+    // A random permutation, which probably has a cycle spanning most records.
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        permutation[i] = i;
+    }
+    for(size_t i = arr_size; i > 1; --i)
+    {
+        size_t j = ((size_t)rand() * RAND_MAX + rand()) % i, tmp = permutation[i - 1];
+        permutation[i - 1] = permutation[j];
+        permutation[j] = tmp;
+    }
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        expected[i] = arr[permutation[i]];
+    }
+    status = outro_apply_permutation(arr, arr_size, sizeof *arr, permutation);
+    assert(status == 0);
+    assert(memcmp(arr, expected, arr_size * sizeof *arr) == 0);
+
+    // Invalid permutations are rejected without changing the records.
+    if(arr_size > 1)
+    {
+        permutation[0] = permutation[1];
+        status = outro_apply_permutation(arr, arr_size, sizeof *arr, permutation);
+        assert(status == -1);
+        permutation[0] = arr_size;
+        status = outro_apply_permutation(arr, arr_size, sizeof *arr, permutation);
+        assert(status == -1);
+        assert(memcmp(arr, expected, arr_size * sizeof *arr) == 0);
+    }
+
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        pointers[i] = arr + i;
+    }
+    status = outro_sort_indirect(pointers, arr_size, wide_record_key);
+    assert(status == 0);
+    (void)status;
+    for(size_t i = 0; i < arr_size; ++i)
+    {
+        struct WideRecord const *record = pointers[i];
+        assert(i == 0 || ((struct WideRecord const *)pointers[i - 1])->key <= record->key);
+        assert(record->payload[6] == record->key * 7 + 6);
+        (void)record;
+    }
+    free(permutation);
+    free(pointers);
+    free(expected);
+    free(arr);
+}
+
+/******************************************************************************
+ * Check whether partial sorting, selection and selection from a stream work
+ * correctly, for prefixes of various sizes.
+ *
+ * @param arr_size Number of elements.
+ *****************************************************************************/
+void
+test_selection(size_t arr_size)
+{
+    int *unsorted = malloc(arr_size * sizeof *unsorted);
+    int *arr = malloc(arr_size * sizeof *arr);
+    int *sorted = malloc(arr_size * sizeof *sorted);
+    size_t prefix_sizes[] = {0, 1, 2, arr_size / 100, arr_size / 3, arr_size - 1, arr_size};
+    for(enum Fill mode = FILL_RANDOM; mode < FILL_COUNT; ++mode)
+    {
+        fill(unsorted, unsorted + arr_size, mode);
+        memcpy(sorted, unsorted, arr_size * sizeof *sorted);
+        outro_sort(sorted, sorted + arr_size);
+        for(size_t i = 0; i < sizeof prefix_sizes / sizeof *prefix_sizes; ++i)
+        {
+            size_t k = prefix_sizes[i] < arr_size ? prefix_sizes[i] : arr_size;
+            memcpy(arr, unsorted, arr_size * sizeof *arr);
+            outro_partial_sort(arr, arr + k, arr + arr_size);
+            for(size_t j = 0; j < arr_size; ++j)
+            {
+                assert(j < k ? arr[j] == sorted[j] : k == 0 || arr[j] >= sorted[k - 1]);
+            }
+
+            if(k < arr_size)
+            {
+                memcpy(arr, unsorted, arr_size * sizeof *arr);
+                outro_nth_element(arr, arr + k, arr + arr_size);
+                for(size_t j = 0; j < arr_size; ++j)
+                {
+                    assert(j < k ? arr[j] <= sorted[k] : j == k ? arr[j] == sorted[k] : arr[j] >= sorted[k]);
+                }
+            }
+
+            // Batches of random sizes.
+            memcpy(arr, unsorted, arr_size * sizeof *arr);
+            struct OutroSortTopK top_k;
+            int status = outro_top_k_init(&top_k, k);
+            assert(status == 0);
+            (void)status;
+            for(size_t begin = 0, end; begin < arr_size; begin = end)
+            {
+                end = begin + rand() % 4096;
+                end = end < arr_size ? end : arr_size;
+                outro_top_k_push(&top_k, arr + begin, arr + end);
+            }
+            size_t result_size = outro_top_k_result(&top_k);
+            assert(result_size == k);
+            (void)result_size;
+            for(size_t j = 0; j < k; ++j)
+            {
+                assert(top_k.buffer[j] == sorted[j]);
+            }
+            outro_top_k_destroy(&top_k);
+        }
+    }
+    free(sorted);
+    free(arr);
+    free(unsorted);
+}
+
 /******************************************************************************
  * Measure the running time of the sorting algorithm.
  *
+ * @param name Description of the sort function.
  * @param sorter Sort function.
  * @param arr_size Number of elements to sort.
+ * @param mode Distribution of the values.
  *****************************************************************************/
 void
-benchmark(void (*sorter)(int *, int *), size_t arr_size)
+benchmark(char const *name, void (*sorter)(int *, int *), size_t arr_size, enum Fill mode)
 {
     int long long nanoseconds = 0;
     int *arr = malloc(arr_size * sizeof *arr);
     for(int i = 0; i < ITERATIONS; ++i)
     {
-        fill(arr, arr + arr_size);
+        fill(arr, arr + arr_size, mode);
         struct timespec start, stop;
-        clock_gettime(CLOCK_REALTIME, &start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
         sorter(arr, arr + arr_size);
-        clock_gettime(CLOCK_REALTIME, &stop);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
         nanoseconds += stop.tv_nsec - start.tv_nsec;
         nanoseconds += 1000000000L * (stop.tv_sec - start.tv_sec);
     }
     free(arr);
     nanoseconds /= ITERATIONS;
-    printf("%.3lf ms\n", nanoseconds / 1000000.0);
+    printf("%-28s %-16s %.3lf ms\n", name, fill_names[mode], nanoseconds / 1000000.0);
+}
+
+/******************************************************************************
+ * Sort an array, and display the statistics collected while doing so (if the
+ * library was built with `OUTRO_SORT_STATS`).
+ *
+ * @param name Description of the sort function.
+ * @param arr_size Number of elements to sort.
+ *****************************************************************************/
+void
+report_stats(char const *name, size_t arr_size)
+{
+    outro_sort_stats_reset();
+    test(outro_sort, arr_size);
+    struct OutroSortStats stats;
+    if(outro_sort_stats(&stats) != 0)
+    {
+        return;
+    }
+    assert(arr_size <= 16 || stats.queued + stats.spawned + stats.inlined > 0);
+    printf("%-28s queued %llu, spawned %llu, inlined %llu, max depth %llu\n", name, (unsigned long long)stats.queued,
+        (unsigned long long)stats.spawned, (unsigned long long)stats.inlined, (unsigned long long)stats.max_depth);
+    static char const *phase_names[] = {"partition", "leaf", "dispatch"};
+    for(int phase = 0; phase < OUTRO_SORT_PHASE_COUNT && stats.available_counters != 0; ++phase)
+    {
+        uint64_t const *counters = stats.counters[phase];
+        printf("%-28s %-16s cycles %llu, instructions %llu, branch misses %llu, LLC misses %llu\n", name, phase_names[phase],
+            (unsigned long long)counters[OUTRO_SORT_COUNTER_CYCLES], (unsigned long long)counters[OUTRO_SORT_COUNTER_INSTRUCTIONS],
+            (unsigned long long)counters[OUTRO_SORT_COUNTER_BRANCH_MISSES], (unsigned long long)counters[OUTRO_SORT_COUNTER_LLC_MISSES]);
+    }
 }
 
 /******************************************************************************
@@ -101,7 +707,74 @@ main(int const argc, char const *argv[])
 
     outro_sort_configure(32, 32768U);
     srand(time(NULL));
-    test(outro_sort, arr_size);
-    benchmark(outro_sort, arr_size);
+    for(int pool = 0; pool <= 1; ++pool)
+    {
+        if(pool)
+        {
+            outro_sort_init(8);
+        }
+        outro_sort_configure_radix(0);
+        for(int partition = OUTRO_SORT_PARTITION_AUTO; partition <= OUTRO_SORT_PARTITION_AVX512; ++partition)
+        {
+            outro_sort_configure_partition(partition);
+            test(outro_sort, arr_size);
+            test_types(arr_size);
+        }
+        outro_sort_configure_partition(OUTRO_SORT_PARTITION_AUTO);
+
+        test_selection(arr_size);
+        test_stable(arr_size);
+        for(size_t small_size = 1; small_size <= 64; ++small_size)
+        {
+            test_stable(small_size);
+            test_argsort(small_size);
+            test_strings(small_size);
+        }
+        test_argsort(arr_size);
+        test_async(arr_size, pool);
+        test_context(arr_size);
+        test_profile(arr_size);
+        test_strings(arr_size);
+
+        // Partition every large subarray using multiple threads.
+        outro_sort_configure_parallel_partition(1);
+        test(outro_sort, arr_size);
+        test_types(arr_size);
+        test_selection(arr_size);
+        outro_sort_configure_parallel_partition(1048576U);
+
+        outro_sort_configure_mode(OUTRO_SORT_MODE_SAMPLE);
+        test(outro_sort, arr_size);
+        test_types(arr_size);
+        benchmark(pool ? "outro_sort (pool, sample)" : "outro_sort (sample)", outro_sort, arr_size, FILL_RANDOM);
+        outro_sort_configure_mode(OUTRO_SORT_MODE_PARTITION);
+
+        // Subarrays of every size around the leaf size, sorted using a
+        // sorting network or insertion sort.
+        for(size_t leaf_size = 3; leaf_size <= 32; leaf_size *= 2)
+        {
+            outro_sort_configure_leaf(leaf_size);
+            for(size_t small_size = 1; small_size <= 64; ++small_size)
+            {
+                test(outro_sort, small_size);
+            }
+            test(outro_sort, arr_size);
+        }
+        outro_sort_configure_leaf(16);
+        test(insertion_sort, arr_size < 4096 ? arr_size : 4096);
+        for(enum Fill mode = FILL_RANDOM; mode < FILL_COUNT; ++mode)
+        {
+            benchmark(pool ? "outro_sort (pool)" : "outro_sort", outro_sort, arr_size, mode);
+        }
+        report_stats(pool ? "outro_sort (pool)" : "outro_sort", arr_size);
+
+        // Use radix sort regardless of the size.
+        outro_sort_configure_radix(1);
+        test(outro_sort, arr_size);
+        test_types(arr_size);
+        test_async(arr_size, pool);
+        benchmark(pool ? "outro_sort (pool, radix)" : "outro_sort (radix)", outro_sort, arr_size, FILL_RANDOM);
+    }
+    outro_sort_shutdown();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "outro_sort.hh"
+
+std::mt19937_64 mersenne(std::random_device{}());
+
+///////////////////////////////////////////////////////////////////////////////
+/// Check whether `outro::sort` produces the same result as `std::sort`.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type, typename Compare>
+void test(std::vector<Type> vec, Compare comp)
+{
+    std::vector<Type> vec_copy(vec);
+    std::sort(vec_copy.begin(), vec_copy.end(), comp);
+    outro::sort(vec.begin(), vec.end(), comp);
+    for(std::size_t i = 0; i < vec.size(); ++i)
+    {
+        if(comp(vec[i], vec_copy[i]) || comp(vec_copy[i], vec[i]))
+        {
+            throw std::runtime_error("Wrong result obtained!");
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Check whether `outro::sort` works correctly with various element types,
+/// comparators and iterators.
+///////////////////////////////////////////////////////////////////////////////
+void test_types(std::size_t vec_size)
+{
+    std::vector<std::uint64_t> u64s(vec_size);
+    std::generate(u64s.begin(), u64s.end(), std::ref(mersenne));
+    test(u64s, std::less<std::uint64_t>());
+    test(u64s, std::greater<std::uint64_t>());
+
+    std::vector<std::pair<int, int>> pairs(vec_size);
+    for(auto& p: pairs)
+    {
+        p = {mersenne() % 256, mersenne() % 256};
+    }
+    test(pairs, std::less<std::pair<int, int>>());
+
+    std::vector<std::string> strings(vec_size / 16);
+    for(auto& s: strings)
+    {
+        s = std::to_string(mersenne() % 100000);
+    }
+    test(strings, std::less<std::string>());
+
+    // Move-only elements, sorted through a raw pointer.
+    std::vector<std::unique_ptr<int>> ptrs;
+    for(std::size_t i = 0; i < vec_size / 16; ++i)
+    {
+        ptrs.emplace_back(new int(mersenne() % 1000));
+    }
+    outro::sort(&ptrs[0], &ptrs[0] + ptrs.size(), [](std::unique_ptr<int> const& a, std::unique_ptr<int> const& b){ return *a < *b; });
+    if(!std::is_sorted(ptrs.begin(), ptrs.end(), [](std::unique_ptr<int> const& a, std::unique_ptr<int> const& b){ return *a < *b; }))
+    {
+        throw std::runtime_error("Wrong result obtained!");
+    }
+
+    // Exceptions thrown by the comparator in any thread must reach the
+    // caller.
+    bool caught = false;
+    try
+    {
+        outro::sort(u64s.begin(), u64s.end(), [](std::uint64_t a, std::uint64_t b)
+        {
+            if(a % 1000003 == 0 || b % 1000003 == 0)
+            {
+                throw std::invalid_argument("comparator");
+            }
+            return a < b;
+        });
+    }
+    catch(std::invalid_argument const&)
+    {
+        caught = true;
+    }
+    if(!caught && std::any_of(u64s.begin(), u64s.end(), [](std::uint64_t u){ return u % 1000003 == 0; }))
+    {
+        throw std::runtime_error("Exception was not propagated!");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Comparator of McIlroy's adversary ("A Killer Adversary for Quicksort"),
+/// which decides the values of the elements as they are compared, so as to
+/// make the sort take as long as possible. Copies share the same state.
+///////////////////////////////////////////////////////////////////////////////
+struct Adversary
+{
+    struct State
+    {
+        std::vector<std::size_t> values;
+        std::size_t num_solid;
+        std::size_t candidate;
+        std::size_t gas;
+    };
+    std::shared_ptr<State> state;
+
+    bool operator()(std::size_t a, std::size_t b) const
+    {
+        State& st = *state;
+        if(st.values[a] == st.gas && st.values[b] == st.gas)
+        {
+            st.values[a == st.candidate ? a : b] = st.num_solid++;
+        }
+        if(st.values[a] == st.gas)
+        {
+            st.candidate = a;
+        }
+        else if(st.values[b] == st.gas)
+        {
+            st.candidate = b;
+        }
+        return st.values[a] < st.values[b];
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Check whether `outro::sort` sorts organ pipes, and an input built by
+/// McIlroy's adversary against it, using O(n log n) comparisons.
+///////////////////////////////////////////////////////////////////////////////
+void test_adversarial(std::size_t vec_size)
+{
+    std::vector<std::uint64_t> organ_pipe(vec_size);
+    for(std::size_t i = 0; i < vec_size; ++i)
+    {
+        organ_pipe[i] = i < vec_size / 2 ? i : vec_size - i;
+    }
+    test(organ_pipe, std::less<std::uint64_t>());
+
+    // The adversary relies on comparisons happening in one thread.
+    outro::configure(1, 32768);
+    Adversary adversary{std::make_shared<Adversary::State>()};
+    adversary.state->values.assign(vec_size, vec_size);
+    adversary.state->num_solid = 0;
+    adversary.state->candidate = 0;
+    adversary.state->gas = vec_size;
+    std::vector<std::size_t> indices(vec_size);
+    for(std::size_t i = 0; i < vec_size; ++i)
+    {
+        indices[i] = i;
+    }
+    outro::sort(indices.begin(), indices.end(), adversary);
+    std::vector<std::size_t> killer(adversary.state->values);
+    for(auto& value: killer)
+    {
+        if(value == vec_size)
+        {
+            value = adversary.state->num_solid++;
+        }
+    }
+
+    std::size_t comparisons = 0, log_size = 1;
+    for(std::size_t size = vec_size; size > 1; size >>= 1)
+    {
+        ++log_size;
+    }
+    outro::sort(killer.begin(), killer.end(), [&comparisons](std::size_t a, std::size_t b){ ++comparisons; return a < b; });
+    outro::configure(32, 32768);
+    if(!std::is_sorted(killer.begin(), killer.end()))
+    {
+        throw std::runtime_error("Wrong result obtained!");
+    }
+    if(comparisons > 16 * vec_size * log_size)
+    {
+        throw std::runtime_error("Adversarial input took " + std::to_string(comparisons) + " comparisons!");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Measure the running time of a sort function.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Sorter>
+void benchmark(char const *name, Sorter sorter, std::size_t vec_size)
+{
+    int constexpr iterations = 16;
+    std::vector<std::uint64_t> vec(vec_size);
+    long long nanoseconds = 0;
+    for(int i = 0; i < iterations; ++i)
+    {
+        std::generate(vec.begin(), vec.end(), std::ref(mersenne));
+        auto start = std::chrono::steady_clock::now();
+        sorter(vec.begin(), vec.end());
+        auto stop = std::chrono::steady_clock::now();
+        nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+    }
+    std::cout << std::left << std::setw(24) << name << " " << std::fixed << std::setprecision(3);
+    std::cout << nanoseconds / iterations / 1000000.0 << " ms\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Main function.
+///////////////////////////////////////////////////////////////////////////////
+int main(int const argc, char const *argv[])
+{
+    std::size_t vec_size = 1UL << 20;
+    if(argc > 1)
+    {
+        std::size_t vec_size_ = std::strtoul(argv[1], nullptr, 10);
+        if(0 < vec_size_ && vec_size_ < vec_size)
+        {
+            vec_size = vec_size_;
+        }
+    }
+
+    using Iterator = std::vector<std::uint64_t>::iterator;
+    test_types(vec_size);
+    test_adversarial(vec_size < 100000 ? vec_size : 100000);
+    benchmark("std::sort", [](Iterator first, Iterator last){ std::sort(first, last); }, vec_size);
+    benchmark("outro::sort", [](Iterator first, Iterator last){ outro::sort(first, last); }, vec_size);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "outro_sort.h"
+
+/******************************************************************************
+ * Print the usage.
+ *
+ * @param name Name of the program.
+ *****************************************************************************/
+static void
+usage(char const *name)
+{
+    fprintf(stderr, "usage: %s [-n size] [-s seed] [-p workers] [-o profile]\n", name);
+    fprintf(stderr, "Find the settings with which outro sort is fastest on this machine.\n");
+    fprintf(stderr, "  -n size     number of elements sorted while tuning (default 524288)\n");
+    fprintf(stderr, "  -s seed     seed of the elements (default 1)\n");
+    fprintf(stderr, "  -p workers  tune with a thread pool of this size (default: no pool)\n");
+    fprintf(stderr, "  -o profile  file to write the profile to (default outro_sort.profile)\n");
+    fprintf(stderr, "Set OUTRO_SORT_PROFILE to the profile to have outro_sort_init load it.\n");
+}
+
+/******************************************************************************
+ * Main function. The settings found are written to a profile, which is then
+ * printed.
+ *****************************************************************************/
+int
+main(int const argc, char *argv[])
+{
+    size_t size = 1UL << 19;
+    uint64_t seed = 1;
+    int num_workers = 0;
+    char const *path = "outro_sort.profile";
+    for(int opt; (opt = getopt(argc, argv, "n:s:p:o:")) != -1;)
+    {
+        switch(opt)
+        {
+            case 'n':
+                size = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'p':
+                num_workers = atoi(optarg);
+                break;
+            case 'o':
+                path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(argc != optind || size == 0 || num_workers < 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if(num_workers > 0 && outro_sort_init(num_workers) != 0)
+    {
+        fprintf(stderr, "%s: could not start the thread pool\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    struct OutroSortContext ctx;
+    if(outro_sort_tune(&ctx, size, seed) != 0)
+    {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    outro_sort_shutdown();
+    if(outro_sort_profile_save(&ctx, path) != 0)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    FILE *profile = fopen(path, "r");
+    if(profile != NULL)
+    {
+        for(int c; (c = fgetc(profile)) != EOF;)
+        {
+            putchar(c);
+        }
+        fclose(profile);
+    }
+    return EXIT_SUCCESS;
+}
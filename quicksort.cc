@@ -5,14 +5,10 @@
 #include <iterator>
 #include <limits>
 #include <random>
+#include <stdexcept>
 #include <vector>
 
-// A vector is said to be small if it contains these many or fewer elements.
-size_t constexpr chunk_size = 15;
-
-// Function prototypes are required for mutually recursive functions.
-template <typename Type> Type quickselect(std::vector<Type>& vec, size_t pos, bool recursive=false);
-template <typename Type> Type get_pivot(std::vector<Type> const& vec);
+#include "quicksort.hh"
 
 ///////////////////////////////////////////////////////////////////////////////
 /// Display a vector.
@@ -29,133 +25,104 @@ void print_vector(std::vector<Type> const& vec)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-/// Find the median of a vector by sorting it. This mutates the input vector!
-///////////////////////////////////////////////////////////////////////////////
-template <typename Type>
-Type naive_median(std::vector<Type>& vec)
-{
-    std::sort(vec.begin(), vec.end());
-    return vec[vec.size() / 2];
-}
-
-///////////////////////////////////////////////////////////////////////////////
-/// Find the median of a vector by sorting it.
-///////////////////////////////////////////////////////////////////////////////
-template <typename Type>
-Type naive_median_sandboxed(std::vector<Type> vec)
-{
-    std::sort(vec.begin(), vec.end());
-    return vec[vec.size() / 2];
-}
-
-///////////////////////////////////////////////////////////////////////////////
-/// Choose a good pivot for partitioning the vector. This function should not
-/// be called with small vectors.
+/// Test the implementation.
 ///////////////////////////////////////////////////////////////////////////////
-template <typename Type>
-Type get_pivot(std::vector<Type> const& vec)
+void test_quickselect(int num_of_sizes)
 {
-    // Find the median of each full-sized chunk of the vector.
-    std::vector<Type> medians(vec.size() / chunk_size);
-    for(size_t i = 0, j = 0; i + chunk_size - 1 < vec.size(); i += chunk_size, ++j)
+    std::random_device device;
+    std::mt19937 mersenne(device());
+    std::uniform_int_distribution<int> distribution(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    auto generator = [&distribution, &mersenne](){ return distribution(mersenne); };
+    for(int vec_size = 1; vec_size <= num_of_sizes; ++vec_size)
     {
-        std::vector<Type> chunk(&vec[i], &vec[i + chunk_size]);
-        std::sort(chunk.begin(), chunk.end());
-        medians[j] = chunk[chunk_size / 2];
-    }
-
-    return quickselect(medians, medians.size() / 2, true);
-}
+        std::vector<int> vec(vec_size);
+        std::generate(vec.begin(), vec.end(), generator);
+        std::vector<int> vec_copy(vec);
+        auto naive = naive_median_sandboxed(vec);
 
-///////////////////////////////////////////////////////////////////////////////
-/// Find the element which would be at the given position in the vector if the
-/// vector were sorted. If the vector is small, the element is found by
-/// actually sorting it.
-///////////////////////////////////////////////////////////////////////////////
-template <typename Type>
-Type quickselect(std::vector<Type>& vec, size_t pos, bool recursive)
-{
-    size_t vec_size = vec.size();
-    if(vec_size <= chunk_size)
-    {
-        // It is okay to mutate the input vector in a recursive call.
-        // Otherwise, it came from the original caller, and must not be
-        // modified.
-        if(recursive)
+        auto start = std::chrono::steady_clock::now();
+        auto efficient = quickselect(vec, vec.size() / 2);
+        auto stop = std::chrono::steady_clock::now();
+        if(vec != vec_copy)
         {
-            std::sort(vec.begin(), vec.end());
-            return vec[pos];
+            throw std::runtime_error("Input vector was modified!");
+        }
+        if(naive != efficient)
+        {
+            throw std::runtime_error("Wrong result obtained!");
         }
-        std::vector<Type> vec_copy(vec);
-        std::sort(vec_copy.begin(), vec_copy.end());
-        return vec_copy[pos];
-    }
 
-    // Divide the elements into three categories: less than, greater than and
-    // equal to the pivot. There is no need to create a vector for the latter.
-    Type pivot = get_pivot(vec);
-    std::vector<Type> lows, highs;
-    lows.reserve(vec_size);
-    highs.reserve(vec_size);
-    size_t pivots_size = 0;
-    for(auto const& v: vec)
-    {
-        if(v < pivot)
+        // Few unique values are used for every other size, to exercise the
+        // handling of duplicates.
+        std::vector<int> vec_inplace(vec);
+        auto pos = static_cast<size_t>(vec_size - 1) * (vec_size % 3) / 2;
+        if(vec_size % 2 == 0)
         {
-            lows.push_back(v);
+            std::transform(vec_inplace.begin(), vec_inplace.end(), vec_inplace.begin(), [](int v){ return v & 7; });
         }
-        else if(v > pivot)
+        std::vector<int> vec_sorted(vec_inplace);
+        std::sort(vec_sorted.begin(), vec_sorted.end());
+        auto selected = quickselect_inplace(vec_inplace, pos);
+        if(selected != vec_sorted[pos])
         {
-            highs.push_back(v);
+            throw std::runtime_error("Wrong result obtained in place!");
         }
-        else
+        if(std::any_of(vec_inplace.begin(), vec_inplace.begin() + pos, [selected](int v){ return selected < v; })
+            || std::any_of(vec_inplace.begin() + pos, vec_inplace.end(), [selected](int v){ return v < selected; }))
         {
-            ++pivots_size;
+            throw std::runtime_error("Vector was not partitioned!");
+        }
+        std::sort(vec_inplace.begin(), vec_inplace.end());
+        if(vec_inplace != vec_sorted)
+        {
+            throw std::runtime_error("Elements were lost!");
         }
-    }
 
-    if(pos < lows.size())
-    {
-        return quickselect(lows, pos, true);
-    }
-    if(pos < lows.size() + pivots_size)
-    {
-        return pivot;
+        auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+        std::cout << std::setw(8) << vec_size << " ";
+        std::cout << std::setw(12) << delay << "\n";
     }
-    return quickselect(highs, pos - lows.size() - pivots_size, true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-/// Test the implementation.
+/// Test the selection of many positions at once.
 ///////////////////////////////////////////////////////////////////////////////
-void test_quickselect(int num_of_sizes)
+void test_multiselect(void)
 {
     std::random_device device;
     std::mt19937 mersenne(device());
-    std::uniform_int_distribution<int> distribution(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
-    auto generator = [&distribution, &mersenne](){ return distribution(mersenne); };
-    for(int vec_size = 1; vec_size <= num_of_sizes; ++vec_size)
+    for(int vec_size = 1; vec_size <= 1 << 20; vec_size = vec_size * 3 + 1)
     {
         std::vector<int> vec(vec_size);
-        std::generate(vec.begin(), vec.end(), generator);
-        std::vector<int> vec_copy(vec);
-        auto naive = naive_median_sandboxed(vec);
+        std::generate(vec.begin(), vec.end(), [&mersenne, vec_size](){ return mersenne() % vec_size; });
+        std::vector<int> vec_sorted(vec);
+        std::sort(vec_sorted.begin(), vec_sorted.end());
 
-        auto start = std::chrono::steady_clock::now();
-        auto efficient = quickselect(vec, vec.size() / 2);
-        auto stop = std::chrono::steady_clock::now();
+        // Quantiles, as well as some repeated positions.
+        std::vector<size_t> positions;
+        for(double quantile: {0.0, 0.5, 0.5, 0.9, 0.99, 0.999, 1.0})
+        {
+            positions.push_back(static_cast<size_t>(quantile * (vec_size - 1)));
+        }
+        std::vector<int> expected;
+        for(auto pos: positions)
+        {
+            expected.push_back(vec_sorted[pos]);
+        }
+
+        std::vector<int> vec_copy(vec);
+        if(quickselect(vec, positions) != expected || quickselect_parallel(vec, positions, 4) != expected)
+        {
+            throw std::runtime_error("Wrong results obtained!");
+        }
         if(vec != vec_copy)
         {
             throw std::runtime_error("Input vector was modified!");
         }
-        if(naive != efficient)
+        if(quickselect_inplace(vec, positions) != expected)
         {
-            throw std::runtime_error("Wrong result obtained!");
+            throw std::runtime_error("Wrong results obtained in place!");
         }
-
-        auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
-        std::cout << std::setw(8) << vec_size << " ";
-        std::cout << std::setw(12) << delay << "\n";
     }
 }
 
@@ -164,6 +131,7 @@ void test_quickselect(int num_of_sizes)
 ///////////////////////////////////////////////////////////////////////////////
 int main(void)
 {
+    test_multiselect();
     test_quickselect(10000);
     return 0;
 }
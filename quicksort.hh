@@ -0,0 +1,341 @@
+#ifndef TFPF_VERSATILE_SORT_QUICKSORT_HH_
+#define TFPF_VERSATILE_SORT_QUICKSORT_HH_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A range is said to be small if it contains these many or fewer elements.
+size_t constexpr chunk_size = 15;
+
+// Function prototypes are required for mutually recursive functions.
+template <typename Iterator> void introselect(Iterator first, Iterator nth, Iterator last, int depth);
+template <typename Iterator> Iterator median_of_medians(Iterator first, Iterator last);
+
+///////////////////////////////////////////////////////////////////////////////
+/// Find the median of a vector by sorting it. This mutates the input vector!
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+Type naive_median(std::vector<Type>& vec)
+{
+    std::sort(vec.begin(), vec.end());
+    return vec[vec.size() / 2];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Find the median of a vector by sorting it.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+Type naive_median_sandboxed(std::vector<Type> vec)
+{
+    std::sort(vec.begin(), vec.end());
+    return vec[vec.size() / 2];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Sort a small range.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator>
+void sort_small_range(Iterator first, Iterator last)
+{
+    for(Iterator i = first; i != last; ++i)
+    {
+        auto value = std::move(*i);
+        Iterator j = i;
+        for(; j != first && value < *(j - 1); --j)
+        {
+            *j = std::move(*(j - 1));
+        }
+        *j = std::move(value);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Choose a pivot which is guaranteed to split the range reasonably well:
+/// move the median of each group of five elements to the front, and select
+/// the median of those in place. This function should not be called with
+/// small ranges.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator>
+Iterator median_of_medians(Iterator first, Iterator last)
+{
+    Iterator medians_last = first;
+    for(auto remaining = last - first; remaining >= 5; remaining -= 5)
+    {
+        Iterator group = first + 5 * (medians_last - first);
+        sort_small_range(group, group + 5);
+        std::iter_swap(medians_last++, group + 2);
+    }
+    Iterator pivot = first + (medians_last - first) / 2;
+    introselect(first, pivot, medians_last, 0);
+    return pivot;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Partition a range which is not small around a pivot, which is the median
+/// of three elements, or the median of medians if `guaranteed` is set. Return
+/// the position of the pivot, which is where it would be if the range were
+/// sorted.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator>
+Iterator partition_around_pivot(Iterator first, Iterator last, bool guaranteed)
+{
+    Iterator pivot;
+    if(!guaranteed)
+    {
+        Iterator middle = first + (last - first) / 2, back = last - 1;
+        if(*middle < *first)
+        {
+            std::iter_swap(middle, first);
+        }
+        if(*back < *middle)
+        {
+            std::iter_swap(back, middle);
+            if(*middle < *first)
+            {
+                std::iter_swap(middle, first);
+            }
+        }
+        pivot = middle;
+    }
+    else
+    {
+        pivot = median_of_medians(first, last);
+    }
+
+    // Hoare's partitioning scheme. Both scans stop at elements equal to the
+    // pivot, so that duplicates are split evenly.
+    std::iter_swap(first, pivot);
+    auto const& pivot_value = *first;
+    Iterator i = first + 1, j = last - 1;
+    for(;;)
+    {
+        while(i <= j && *i < pivot_value)
+        {
+            ++i;
+        }
+        while(i <= j && pivot_value < *j)
+        {
+            --j;
+        }
+        if(i >= j)
+        {
+            break;
+        }
+        std::iter_swap(i++, j--);
+    }
+    std::iter_swap(first, j);
+    return j;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Number of times a range may be partitioned using medians of three before
+/// switching to the median of medians.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator>
+int selection_depth(Iterator first, Iterator last)
+{
+    int depth = 0;
+    for(auto size = last - first; size > 1; size >>= 1)
+    {
+        depth += 2;
+    }
+    return depth;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Rearrange the elements of a range so that the element at the given
+/// position is the one which would be there if the range were sorted, with no
+/// greater elements before it and no smaller elements after it. Pivots are
+/// medians of three until the range has been partitioned too many times,
+/// after which the median of medians is used, so that the running time is
+/// linear in the worst case. No memory is allocated.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator>
+void introselect(Iterator first, Iterator nth, Iterator last, int depth)
+{
+    while(static_cast<size_t>(last - first) > chunk_size)
+    {
+        Iterator pivot = partition_around_pivot(first, last, depth-- <= 0);
+        if(nth == pivot)
+        {
+            return;
+        }
+        if(nth < pivot)
+        {
+            last = pivot;
+        }
+        else
+        {
+            first = pivot + 1;
+        }
+    }
+    sort_small_range(first, last);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Rearrange the elements of a range as `std::nth_element` does.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator>
+void introselect(Iterator first, Iterator nth, Iterator last)
+{
+    introselect(first, nth, last, selection_depth(first, last));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Rearrange the elements of a range so that the elements at all the given
+/// positions (offsets from `base`, in ascending order) are the ones which
+/// would be there if the range were sorted. After each partition, only the
+/// parts containing requested positions are partitioned further: the one
+/// with fewer positions recursively, the other by the same call. No memory is
+/// allocated.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator, typename PosIterator>
+void multiselect(Iterator base, Iterator first, Iterator last, PosIterator pos_first, PosIterator pos_last, int depth)
+{
+    while(pos_first != pos_last)
+    {
+        if(static_cast<size_t>(last - first) <= chunk_size)
+        {
+            sort_small_range(first, last);
+            return;
+        }
+        Iterator pivot = partition_around_pivot(first, last, depth-- <= 0);
+        auto pivot_pos = static_cast<size_t>(pivot - base);
+        PosIterator pos_split = std::lower_bound(pos_first, pos_last, pivot_pos);
+        PosIterator pos_right = std::upper_bound(pos_split, pos_last, pivot_pos);
+        if(pos_split - pos_first < pos_last - pos_right)
+        {
+            multiselect(base, first, pivot, pos_first, pos_split, depth);
+            first = pivot + 1;
+            pos_first = pos_right;
+        }
+        else
+        {
+            multiselect(base, pivot + 1, last, pos_right, pos_last, depth);
+            last = pivot;
+            pos_last = pos_split;
+        }
+    }
+}
+
+// Parts smaller than this are not handed to another thread by
+// `multiselect_parallel`.
+size_t constexpr parallel_chunk_size = 1 << 16;
+
+///////////////////////////////////////////////////////////////////////////////
+/// Do what `multiselect` does using up to the given number of threads. When
+/// both parts of a large partition contain requested positions, a new thread
+/// handles one of them.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Iterator, typename PosIterator>
+void multiselect_parallel(Iterator base, Iterator first, Iterator last, PosIterator pos_first, PosIterator pos_last, int depth, unsigned num_threads)
+{
+    while(pos_first != pos_last)
+    {
+        if(num_threads < 2 || static_cast<size_t>(last - first) < 2 * parallel_chunk_size)
+        {
+            multiselect(base, first, last, pos_first, pos_last, depth);
+            return;
+        }
+        Iterator pivot = partition_around_pivot(first, last, depth-- <= 0);
+        auto pivot_pos = static_cast<size_t>(pivot - base);
+        PosIterator pos_split = std::lower_bound(pos_first, pos_last, pivot_pos);
+        PosIterator pos_right = std::upper_bound(pos_split, pos_last, pivot_pos);
+        if(pos_split != pos_first && pos_right != pos_last)
+        {
+            unsigned left_threads = num_threads / 2;
+            std::thread worker(multiselect_parallel<Iterator, PosIterator>, base, first, pivot, pos_first, pos_split, depth, left_threads);
+            multiselect_parallel(base, pivot + 1, last, pos_right, pos_last, depth, num_threads - left_threads);
+            worker.join();
+            return;
+        }
+        if(pos_split != pos_first)
+        {
+            last = pivot;
+            pos_last = pos_split;
+        }
+        else
+        {
+            first = pivot + 1;
+            pos_first = pos_right;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Find the element which would be at the given position in the vector if the
+/// vector were sorted. This mutates the input vector, but does not allocate
+/// any memory.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+Type quickselect_inplace(std::vector<Type>& vec, size_t pos)
+{
+    introselect(vec.begin(), vec.begin() + pos, vec.end());
+    return vec[pos];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Find the element which would be at the given position in the vector if the
+/// vector were sorted. The elements are rearranged in a single scratch copy.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+Type quickselect(std::vector<Type> const& vec, size_t pos)
+{
+    std::vector<Type> scratch(vec);
+    return quickselect_inplace(scratch, pos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Find the elements which would be at the given positions (in ascending
+/// order) in the vector if the vector were sorted, such as several quantiles.
+/// This mutates the input vector.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+std::vector<Type> quickselect_inplace(std::vector<Type>& vec, std::vector<size_t> const& positions)
+{
+    multiselect(vec.begin(), vec.begin(), vec.end(), positions.begin(), positions.end(), selection_depth(vec.begin(), vec.end()));
+    std::vector<Type> selected;
+    selected.reserve(positions.size());
+    for(auto pos: positions)
+    {
+        selected.push_back(vec[pos]);
+    }
+    return selected;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Find the elements which would be at the given positions (in ascending
+/// order) in the vector if the vector were sorted. The elements are
+/// rearranged in a single scratch copy.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+std::vector<Type> quickselect(std::vector<Type> const& vec, std::vector<size_t> const& positions)
+{
+    std::vector<Type> scratch(vec);
+    return quickselect_inplace(scratch, positions);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Find the elements which would be at the given positions (in ascending
+/// order) in the vector if the vector were sorted, using multiple threads.
+/// The elements are rearranged in a single scratch copy.
+///////////////////////////////////////////////////////////////////////////////
+template <typename Type>
+std::vector<Type> quickselect_parallel(std::vector<Type> const& vec, std::vector<size_t> const& positions, unsigned num_threads=std::thread::hardware_concurrency())
+{
+    std::vector<Type> scratch(vec);
+    multiselect_parallel(scratch.begin(), scratch.begin(), scratch.end(), positions.begin(), positions.end(), selection_depth(scratch.begin(), scratch.end()), num_threads);
+    std::vector<Type> selected;
+    selected.reserve(positions.size());
+    for(auto pos: positions)
+    {
+        selected.push_back(scratch[pos]);
+    }
+    return selected;
+}
+
+#endif  // TFPF_VERSATILE_SORT_QUICKSORT_HH_
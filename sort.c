@@ -1,17 +1,28 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include<errno.h>
+#include<fcntl.h>
+#include<limits.h>
 #include<stdbool.h>
+#include<stdint.h>
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
 #include<time.h>
+#include<unistd.h>
+
+#include"sort.h"
 
 // number of sorting algorithms to test
 #define implemented_algorithms 4
 
-// this should allow code portability
-typedef int dtype;
-
 // this is to create an array of functions
-typedef bool (*farray)(int *, int);
+typedef bool (*farray)(dtype *, int);
+
+// size of the chunks in which text is read and written
+#define chunk_size (1 << 20)
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -108,6 +119,54 @@ bool selection_sort(dtype *array, int size)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/*
+	merge sort
+	the elements are copied into a buffer allocated once
+	each level of recursion sorts the halves of a range in one of the two arrays
+	and merges them into the other, so that no copying back is required
+*/
+
+// function to merge two sorted ranges of the source into the target
+void merge_runs(dtype *source, dtype *target, int begin, int middle, int end)
+{
+	// take from the left range when equal, so that the sort is stable
+	int x, y, count;
+	x = begin;
+	y = middle;
+	count = begin;
+	while(x < middle && y < end)
+	{
+		if(source[x] > source[y])
+		{
+			target[count++] = source[y++];
+		}
+		else
+		{
+			target[count++] = source[x++];
+		}
+	}
+	memcpy(target + count, source + x, (middle - x) * sizeof *target);
+	memcpy(target + count + middle - x, source + y, (end - y) * sizeof *target);
+}
+
+// function to sort a range of the source into the same range of the target
+// both must contain the same elements in this range
+void merge_split(dtype *source, dtype *target, int begin, int end)
+{
+	// nothing to do if there is only one element
+	if(end - begin < 2)
+	{
+		return;
+	}
+
+	// sort the halves into the source, then merge them into the target
+	int middle;
+	middle = begin + ((end - begin) >> 1);
+	merge_split(target, source, begin, middle);
+	merge_split(target, source, middle, end);
+	merge_runs(source, target, begin, middle, end);
+}
+
 // merge sort function
 bool merge_sort(dtype *array, int size)
 {
@@ -117,176 +176,652 @@ bool merge_sort(dtype *array, int size)
 		return 0;
 	}
 
-	// lengths of left and right subarrays
-	int L, R; // using capital L because noobs might confuse 1 and small l
-	L = size >> 1;
-	R = size - L;
-
-	// allocate space for the subarrays
-	dtype *left, *right;
-	left = malloc(L * sizeof *left);
-	right = malloc(R * sizeof *right);
-	if(left == NULL || right == NULL)
+	// allocate the buffer
+	dtype *buffer;
+	buffer = malloc(size * sizeof *buffer);
+	if(buffer == NULL)
 	{
-		printf("Ran out of memory while splitting array for merge sort.\n");
+		printf("Ran out of memory while allocating the buffer for merge sort.\n");
 		return 4;
 	}
+	memcpy(buffer, array, size * sizeof *buffer);
+
+	merge_split(buffer, array, 0, size);
+	free(buffer);
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
 
-	// assign the elements
+/*
+	heap sort
+	the heap is 4-ary rather than binary, so it is half as deep
+	the children of a node are adjacent, and never straddle cache lines if the
+	heap is aligned, so each level of a sift costs at most one cache miss
+	elements are sifted without recursion and without swapping
+*/
+
+// number of children of each node of a heap
+#define heap_arity 4
+
+// number of nodes of a heap which have children
+int heap_internal_nodes(int size)
+{
+	return size > 1 ? (size - 2) / heap_arity + 1 : 0;
+}
+
+// function to place a value in a hole in a heap
+// the hole is first moved down to a leaf, always promoting the largest child,
+// then the value is moved up from there to where it belongs
+// this 'bounce' needs fewer comparisons than comparing the value with the
+// largest child at every level, because the value usually belongs near a leaf
+void sift_heap(dtype *array, int size, int hole, dtype value)
+{
+	int top, full, internal;
+	top = hole;
+	full = size > heap_arity ? (size - heap_arity - 1) / heap_arity + 1 : 0;
+	internal = heap_internal_nodes(size);
+
+	// nodes with all their children (the number of comparisons is constant,
+	// so the loop can be unrolled, and the larger of each pair of children is
+	// selected without a branch)
+	while(hole < full)
+	{
+		int child, count, big;
+		child = hole * heap_arity + 1;
+		big = child;
+		for(count = 1; count < heap_arity; count++)
+		{
+			big = array[child + count] > array[big] ? child + count : big;
+		}
+		array[hole] = array[big];
+		hole = big;
+	}
+	if(hole < internal)
+	{
+		int child, big;
+		child = hole * heap_arity + 1;
+		for(big = child++; child < size; child++)
+		{
+			big = array[child] > array[big] ? child : big;
+		}
+		array[hole] = array[big];
+		hole = big;
+	}
+	while(hole > top)
+	{
+		int parent;
+		parent = (hole - 1) / heap_arity;
+		if(!(value > array[parent]))
+		{
+			break;
+		}
+		array[hole] = array[parent];
+		hole = parent;
+	}
+	array[hole] = value;
+}
+
+// function to make an array a max heap
+// bottom-up (Floyd's method), sifting each internal node from the last one
+void make_heap(dtype *array, int size)
+{
 	int count;
-	for(count = 0; count < L; count++)
+	for(count = heap_internal_nodes(size) - 1; count >= 0; count--)
 	{
-		left[count] = array[count];
+		sift_heap(array, size, count, array[count]);
 	}
-	for(count = 0; count < R; count++)
+}
+
+// function to find how many leading elements to leave out of a heap, so that
+// the children of each node start at a multiple of their total size in memory
+int heap_alignment(dtype const *array, int size)
+{
+	uintptr_t group, misalignment;
+	group = heap_arity * sizeof *array;
+	misalignment = (uintptr_t)(array + 1) % group;
+	if(size <= heap_arity * heap_arity || misalignment % sizeof *array != 0)
 	{
-		right[count] = array[count + L];
+		return 0;
 	}
+	return (group - misalignment) % group / sizeof *array;
+}
 
-	// recursively sort the two subarrays
-	merge_sort(left, L);
-	merge_sort(right, R);
+// heap sort function
+bool heap_sort(dtype *array, int size)
+{
+	// sort all but the first few elements using a heap
+	int skip, count;
+	skip = heap_alignment(array, size);
+	dtype *heap;
+	heap = array + skip;
+	make_heap(heap, size - skip);
 
-	// recombine the two sorted subarrays in ascending order
-	// then release memory which is not required
-	int x, y;
-	x = y = 0;
-	count = 0;
-	while(x < L && y < R)
+	// send largest element to the end
+	// then fill the hole at the root with the element which was there
+	for(count = size - skip - 1; count > 0; count--)
 	{
-		if(left[x] > right[y])
-		{
-			array[count++] = right[y++];
-		}
-		else
+		dtype value;
+		value = heap[count];
+		heap[count] = heap[0];
+		sift_heap(heap, count, 0, value);
+	}
+
+	// insert the elements left out into the sorted part
+	for(count = skip - 1; count >= 0; count--)
+	{
+		dtype value;
+		value = array[count];
+		int low, high;
+		low = count + 1;
+		high = size;
+		while(low < high)
 		{
-			array[count++] = left[x++];
+			int mid;
+			mid = low + ((high - low) >> 1);
+			if(array[mid] < value)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
 		}
+		memmove(array + count, array + count + 1, (low - count - 1) * sizeof *array);
+		array[low - 1] = value;
 	}
-	while(x < L)
+	return 0;
+}
+
+/*
+	priority queue
+	the same heap, whose storage is allocated so that the children of each node
+	start at a multiple of their total size in memory
+*/
+
+// function to resize the storage of a priority queue
+bool heap_reserve(struct heap *heap, int capacity)
+{
+	size_t group;
+	group = heap_arity * sizeof *heap->data;
+	dtype *storage;
+	storage = aligned_alloc(group, (capacity / heap_arity + 2) * group);
+	if(storage == NULL)
+	{
+		return 1;
+	}
+	if(heap->size > 0)
 	{
-		array[count++] = left[x++];
+		memcpy(storage + heap_arity - 1, heap->data, heap->size * sizeof *storage);
 	}
-	while(y < R)
+	free(heap->storage);
+	heap->storage = storage;
+	heap->data = storage + heap_arity - 1;
+	heap->capacity = capacity;
+	return 0;
+}
+
+// function to create an empty priority queue with space for some elements
+bool heap_init(struct heap *heap, int capacity)
+{
+	heap->data = heap->storage = NULL;
+	heap->size = 0;
+	return heap_reserve(heap, capacity > 0 ? capacity : heap_arity);
+}
+
+// function to release the storage of a priority queue
+void heap_free(struct heap *heap)
+{
+	free(heap->storage);
+	heap->data = heap->storage = NULL;
+	heap->size = heap->capacity = 0;
+}
+
+// function to add an element to a priority queue
+bool heap_push(struct heap *heap, dtype value)
+{
+	// the capacity cannot grow past the largest size an int can hold
+	if(heap->size == heap->capacity && (heap->capacity == INT_MAX || heap_reserve(heap, heap->capacity > INT_MAX / 2 ? INT_MAX : heap->capacity * 2)))
 	{
-		array[count++] = right[y++];
+		return 1;
 	}
-	free(left);
-	free(right);
 
+	// move the value up from a new leaf
+	int hole;
+	hole = heap->size++;
+	while(hole > 0 && value > heap->data[(hole - 1) / heap_arity])
+	{
+		heap->data[hole] = heap->data[(hole - 1) / heap_arity];
+		hole = (hole - 1) / heap_arity;
+	}
+	heap->data[hole] = value;
 	return 0;
 }
 
+// function to obtain the largest element of a non-empty priority queue
+dtype heap_top(struct heap const *heap)
+{
+	return heap->data[0];
+}
+
+// function to remove and return the largest element of a non-empty priority
+// queue
+dtype heap_pop(struct heap *heap)
+{
+	dtype top;
+	top = heap->data[0];
+	heap->size--;
+	if(heap->size > 0)
+	{
+		sift_heap(heap->data, heap->size, 0, heap->data[heap->size]);
+	}
+	return top;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /*
-	heap sort
-	one function to make the array with respect to an index a max heap
-	one function to call the above function to sort
+	input and output
+	binary files are mapped into memory, and used without copying if possible
+	text files are parsed in one pass, reading large chunks at a time
 */
 
-// function to make a heap
-void make_heap(dtype *array, int size, int index)
+// check whether the host stores integers in little-endian byte order
+bool little_endian(void)
 {
-	// mark the current element and its children
-	int big, left, right;
-	big = index;
-	left = (index << 1) + 1;
-	right = left + 1;
+	uint16_t probe = 1;
+	unsigned char first;
+	memcpy(&first, &probe, 1);
+	return first == 1;
+}
 
-	// determine the largest element
-	if(left < size && array[left] > array[big])
+// read a little-endian signed integer of the given width (4 or 8 bytes)
+int64_t load_le(unsigned char const *bytes, int width)
+{
+	uint64_t value = 0;
+	int count;
+	for(count = width - 1; count >= 0; count--)
 	{
-		big = left;
+		value = value << 8 | bytes[count];
 	}
-	if(right < size && array[right] > array[big])
+	if(width == 4)
 	{
-		big = right;
+		return (int32_t)(uint32_t)value;
 	}
+	return (int64_t)value;
+}
 
-	// largest element should be at index
-	// if it is not already, make it so
-	if(big != index)
+/*
+	read a binary file of little-endian integers of the given width
+	if the width and byte order match dtype, the mapping itself is returned
+	otherwise, the integers are converted into a new array
+	mapped is set to the number of bytes mapped, or 0 if the array was allocated
+*/
+dtype *read_binary(char const *path, int width, int *size, size_t *mapped)
+{
+	int fd;
+	fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		printf("Could not open \'%s\': %s.\n", path, strerror(errno));
+		return NULL;
+	}
+	struct stat st;
+	if(fstat(fd, &st) < 0)
+	{
+		printf("Could not open \'%s\': %s.\n", path, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	if(st.st_size / width > INT_MAX)
 	{
-		dtype swapper;
-		swapper = array[index];
-		array[index] = array[big];
-		array[big] = swapper;
-		make_heap(array, size, big);
+		printf("File \'%s\' has too many integers.\n", path);
+		close(fd);
+		return NULL;
 	}
-	return;
+	*size = st.st_size / width;
+	*mapped = 0;
+	if(*size == 0)
+	{
+		close(fd);
+		return malloc(sizeof(dtype));
+	}
+	unsigned char *mapping;
+	mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mapping == MAP_FAILED)
+	{
+		printf("Could not map \'%s\': %s.\n", path, strerror(errno));
+		return NULL;
+	}
+
+	// no copy required
+	if(width == sizeof(dtype) && little_endian())
+	{
+		*mapped = st.st_size;
+		return (dtype *)mapping;
+	}
+
+	dtype *array;
+	array = malloc(*size * sizeof *array);
+	int count;
+	for(count = 0; array != NULL && count < *size; count++)
+	{
+		int64_t value;
+		value = load_le(mapping + (size_t)count * width, width);
+		array[count] = (dtype)value;
+		if(array[count] != value)
+		{
+			printf("Integer %lld in \'%s\' does not fit.\n", (long long)value, path);
+			free(array);
+			array = NULL;
+		}
+	}
+	munmap(mapping, st.st_size);
+	return array;
 }
 
-// heap sort function
-bool heap_sort(dtype *array, int size)
+/*
+	parse all integers in a piece of text and append them to the array
+	a number which may continue beyond the text is not parsed unless it is the last piece
+	returns the number of characters consumed, -1 if memory ran out, or -2 if a number does not fit
+*/
+long parse_text(char const *text, long length, bool last, dtype **array, int *size, int *capacity, char const *path)
+{
+	long position, start;
+	position = 0;
+	while(true)
+	{
+		// skip anything which cannot start a number
+		while(position < length && text[position] != '-' && (text[position] < '0' || text[position] > '9'))
+		{
+			position++;
+		}
+		start = position;
+		bool negative;
+		negative = position < length && text[position] == '-';
+		position += negative;
+
+		// accumulate digits, noting whether the value grows beyond what can be stored
+		int64_t value;
+		value = 0;
+		bool overflow;
+		overflow = false;
+		long digits;
+		digits = position;
+		while(position < length && (unsigned char)(text[position] - '0') < 10)
+		{
+			int digit;
+			digit = text[position++] - '0';
+			if(value > (INT64_MAX - digit) / 10)
+			{
+				overflow = true;
+			}
+			else
+			{
+				value = value * 10 + digit;
+			}
+		}
+		digits = position - digits;
+
+		// a number which does not fit so far will not fit once it continues either
+		if(!overflow && position == length && !last)
+		{
+			return start;
+		}
+		if(start == length)
+		{
+			return length;
+		}
+		if(digits == 0)
+		{
+			continue;
+		}
+		value = negative ? -value : value;
+		if(overflow || (dtype)value != value)
+		{
+			printf("Integer %.*s%s in \'%s\' does not fit.\n", (int)(position - start < 32 ? position - start : 32), text + start, position - start > 32 ? "..." : "", path);
+			return -2;
+		}
+
+		// grow the array geometrically
+		if(*size == *capacity)
+		{
+			dtype *grown;
+			*capacity *= 2;
+			grown = realloc(*array, *capacity * sizeof *grown);
+			if(grown == NULL)
+			{
+				return -1;
+			}
+			*array = grown;
+		}
+		(*array)[(*size)++] = (dtype)value;
+	}
+}
+
+// read a text file of integers separated by anything which is not a digit
+dtype *read_text(char const *path, int *size)
 {
-	// make heap, duh
+	FILE *unsorted;
+	unsorted = fopen(path, "r");
+	if(unsorted == NULL)
+	{
+		printf("File \'%s\' not found.\n", path);
+		return NULL;
+	}
+	char *text;
+	text = malloc(chunk_size);
+	dtype *array;
+	array = malloc(sizeof *array);
+	int capacity;
+	capacity = 1;
+	*size = 0;
+
+	// the unparsed end of each chunk is moved to the start of the buffer
+	bool failed;
+	failed = text == NULL || array == NULL;
+	if(failed)
+	{
+		printf("Ran out of memory while reading \'%s\'.\n", path);
+	}
+	long length, consumed;
+	length = 0;
+	while(!failed)
+	{
+		long added;
+		added = fread(text + length, 1, chunk_size - length, unsorted);
+		length += added;
+
+		// a read error must not pass for the end of the file
+		if(ferror(unsorted))
+		{
+			printf("Could not read \'%s\': %s.\n", path, strerror(errno));
+			failed = true;
+			break;
+		}
+		bool last;
+		last = added == 0 || feof(unsorted);
+		consumed = parse_text(text, length, last, &array, size, &capacity, path);
+		failed = consumed < 0 || (consumed == 0 && length == chunk_size);
+		if(consumed == -1)
+		{
+			printf("Ran out of memory while reading \'%s\'.\n", path);
+		}
+		else if(consumed == 0 && length == chunk_size)
+		{
+			printf("Number longer than %d characters in \'%s\'.\n", chunk_size, path);
+		}
+		if(failed || last)
+		{
+			break;
+		}
+		memmove(text, text + consumed, length - consumed);
+		length -= consumed;
+	}
+	free(text);
+	fclose(unsorted);
+	if(failed)
+	{
+		free(array);
+		return NULL;
+	}
+	return array;
+}
+
+// write the array as little-endian binary integers of the size of dtype
+bool write_binary(FILE *sorted, dtype const *array, int size)
+{
+	if(little_endian())
+	{
+		return fwrite(array, sizeof *array, size, sorted) == (size_t)size;
+	}
 	int count;
-	for(count = (size >> 1) - 1; count >= 0; count--)
+	for(count = 0; count < size; count++)
 	{
-		make_heap(array, size, count);
+		unsigned char bytes[sizeof(dtype)];
+		uint64_t value;
+		value = (uint64_t)(int64_t)array[count];
+		int byte;
+		for(byte = 0; byte < (int)sizeof(dtype); byte++)
+		{
+			bytes[byte] = value >> 8 * byte;
+		}
+		if(fwrite(bytes, 1, sizeof bytes, sorted) != sizeof bytes)
+		{
+			return false;
+		}
 	}
+	return true;
+}
 
-	// send largest element to the end
-	// then make heap again
-	for(count = size - 1; count >= 0; count--)
+// write the array as text, one integer per line, formatting into a large buffer
+bool write_text(FILE *sorted, dtype const *array, int size)
+{
+	char *text;
+	text = malloc(chunk_size);
+	if(text == NULL)
 	{
-		dtype swapper;
-		swapper = array[0];
-		array[0] = array[count];
-		array[count] = swapper;
-		make_heap(array, count, 0);
+		return false;
 	}
-	return 0;
+	long length;
+	length = 0;
+	int count;
+	for(count = 0; count < size; count++)
+	{
+		// a 64-bit integer, its sign and a newline take at most 21 characters
+		if(length > chunk_size - 24)
+		{
+			if(fwrite(text, 1, length, sorted) != (size_t)length)
+			{
+				free(text);
+				return false;
+			}
+			length = 0;
+		}
+		char digits[24];
+		int num_digits;
+		num_digits = 0;
+		uint64_t value;
+		value = array[count] < 0 ? -(uint64_t)array[count] : (uint64_t)array[count];
+		do
+		{
+			digits[num_digits++] = '0' + value % 10;
+			value /= 10;
+		}
+		while(value > 0);
+		if(array[count] < 0)
+		{
+			text[length++] = '-';
+		}
+		while(num_digits > 0)
+		{
+			text[length++] = digits[--num_digits];
+		}
+		text[length++] = '\n';
+	}
+	bool result;
+	result = fwrite(text, 1, length, sorted) == (size_t)length;
+	free(text);
+	return result;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// print the usage
+void usage(void)
+{
+	printf("usage:\n");
+	printf("\t./sort.out [-i text|int32|int64] [-o <output file> [-O text|binary]] <file with integers to be sorted>\n");
+	printf("\t-i\tformat of the input: text (default) or little-endian binary integers\n");
+	printf("\t-o\twrite the sorted integers to a file\n");
+	printf("\t-O\tformat of the output: text (default) or binary integers of the same size as the sorted type\n");
+}
+
 // main
-int main(int const argc, char const **argv)
+// left out when the algorithms are linked into another program
+#ifndef SORT_NO_MAIN
+int main(int const argc, char **argv)
 {
 	// check arguments
-	if(argc != 2)
+	char const *input_format, *output_file, *output_format;
+	input_format = "text";
+	output_file = NULL;
+	output_format = "text";
+	int option;
+	while((option = getopt(argc, argv, "i:o:O:")) != -1)
 	{
-		printf("usage:\n");
-		printf("\t./sort.out <file with integers to be sorted>\n");
+		switch(option)
+		{
+			case 'i':
+				input_format = optarg;
+				break;
+			case 'o':
+				output_file = optarg;
+				break;
+			case 'O':
+				output_format = optarg;
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	bool text_output;
+	text_output = strcmp(output_format, "text") == 0;
+	if(argc - optind != 1 || (!text_output && strcmp(output_format, "binary") != 0))
+	{
+		usage();
 		return 1;
 	}
 
-	// open file
-	FILE *unsorted;
-	unsorted = fopen(argv[1], "r");
-	if(unsorted == NULL)
+	// read the numbers to be sorted
+	int size_in_array;
+	size_t mapped;
+	mapped = 0;
+	dtype *in_array;
+	if(strcmp(input_format, "int32") == 0)
 	{
-		printf("File \'%s\' not found.\n", argv[1]);
-		return 2;
+		in_array = read_binary(argv[optind], 4, &size_in_array, &mapped);
 	}
-
-	// count how many numbers need to be sorted
-	int count, random;
-	count = 0;
-	while(!feof(unsorted))
+	else if(strcmp(input_format, "int64") == 0)
 	{
-		/*
-			looks complicated, but the logic is very simple
-			the fscanf tries to read one integer, so maximum return value is 1
-			if return value is not 1, it means scan was unsuccessfull
-		*/
-		count += fscanf(unsorted, "%d", &random) > 0;
+		in_array = read_binary(argv[optind], 8, &size_in_array, &mapped);
 	}
-
-	// allocate space to store the numbers
-	int size_in_array;
-	size_in_array = count;
-	int *in_array;
-	in_array = malloc(size_in_array * sizeof *in_array);
-
-	// store the numbers in this array
-	rewind(unsorted);
-	count = 0;
-	while(count < size_in_array)
+	else if(strcmp(input_format, "text") == 0)
+	{
+		in_array = read_text(argv[optind], &size_in_array);
+	}
+	else
+	{
+		usage();
+		return 1;
+	}
+	if(in_array == NULL)
 	{
-		fscanf(unsorted, "%d", in_array + count++);
+		return 2;
 	}
 
 	// create an array of functions
@@ -299,6 +834,7 @@ int main(int const argc, char const **argv)
 	};
 
 	// analyze the performance of each sort function
+	int count;
 	printf("%14s\t", "bubble sort");
 	printf("%14s\t", "selection sort");
 	printf("%14s\t", "merge sort");
@@ -315,7 +851,50 @@ int main(int const argc, char const **argv)
 		printf("%14d\t", delay);
 		fflush(stdout);
 	}
-
 	printf("\n");
-	return 0;
+
+	// write the sorted numbers
+	int status;
+	status = 0;
+	if(output_file != NULL)
+	{
+		dtype *out_array;
+		out_array = malloc((size_in_array > 0 ? size_in_array : 1) * sizeof *out_array);
+		FILE *sorted;
+		sorted = fopen(output_file, text_output ? "w" : "wb");
+		if(out_array == NULL || sorted == NULL)
+		{
+			printf("Could not write \'%s\'.\n", output_file);
+			status = 2;
+		}
+		else
+		{
+			memcpy(out_array, in_array, size_in_array * sizeof *out_array);
+			heap_sort(out_array, size_in_array);
+			bool written;
+			written = text_output ? write_text(sorted, out_array, size_in_array) : write_binary(sorted, out_array, size_in_array);
+			if(fclose(sorted) != 0 || !written)
+			{
+				printf("Could not write \'%s\'.\n", output_file);
+				status = 2;
+			}
+			sorted = NULL;
+		}
+		if(sorted != NULL)
+		{
+			fclose(sorted);
+		}
+		free(out_array);
+	}
+
+	if(mapped > 0)
+	{
+		munmap(in_array, mapped);
+	}
+	else
+	{
+		free(in_array);
+	}
+	return status;
 }
+#endif
@@ -0,0 +1,43 @@
+#ifndef TFPF_VERSATILE_SORT_SORT_H_
+#define TFPF_VERSATILE_SORT_SORT_H_
+
+#include<stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// this should allow code portability
+typedef int dtype;
+
+// sorting algorithms
+// each one returns 0 on success
+bool bubble_sort(dtype *array, int size);
+bool selection_sort(dtype *array, int size);
+bool merge_sort(dtype *array, int size);
+bool heap_sort(dtype *array, int size);
+
+// heap whose largest element is at the root
+void make_heap(dtype *array, int size);
+void sift_heap(dtype *array, int size, int hole, dtype value);
+
+// priority queue of elements in a heap
+// the functions which return a value return 0 on success
+struct heap
+{
+	dtype *data;
+	int size;
+	int capacity;
+	dtype *storage;
+};
+bool heap_init(struct heap *heap, int capacity);
+void heap_free(struct heap *heap);
+bool heap_push(struct heap *heap, dtype value);
+dtype heap_top(struct heap const *heap);
+dtype heap_pop(struct heap *heap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TFPF_VERSATILE_SORT_SORT_H_
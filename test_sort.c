@@ -0,0 +1,165 @@
+#include<limits.h>
+#include<stdbool.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include "sort.h"
+
+// number of operations on the priority queue
+#define num_operations 100000
+
+// largest number of elements kept in the priority queue
+#define max_size 1000
+
+// function to stop the test if a condition does not hold
+// unlike assert, this is not left out when NDEBUG is defined
+void check(bool condition, char const *description)
+{
+	if(!condition)
+	{
+		fprintf(stderr, "check failed: %s\n", description);
+		abort();
+	}
+}
+
+// function to generate pseudorandom numbers independently of the C library
+unsigned next_random(unsigned *state)
+{
+	*state = *state * 1103515245U + 12345U;
+	return *state >> 8;
+}
+
+// function to compare integers for qsort
+int compare(void const *a, void const *b)
+{
+	dtype x, y;
+	x = *(dtype const *)a;
+	y = *(dtype const *)b;
+	return (x > y) - (x < y);
+}
+
+// function to remove and return the largest element of a non-empty array
+dtype reference_pop(dtype *array, int *size)
+{
+	int count, largest;
+	largest = 0;
+	for(count = 1; count < *size; count++)
+	{
+		if(array[count] > array[largest])
+		{
+			largest = count;
+		}
+	}
+	dtype top;
+	top = array[largest];
+	array[largest] = array[--*size];
+	return top;
+}
+
+// check the priority queue against an unordered array
+// pushes and pops are interleaved while the queue grows from its initial
+// capacity past several doublings, and then shrinks again
+void test_heap(void)
+{
+	struct heap heap;
+	check(heap_init(&heap, 1) == 0, "heap_init");
+	int initial_capacity;
+	initial_capacity = heap.capacity;
+	dtype reference[max_size];
+	int size, count;
+	size = 0;
+	unsigned state;
+	state = 1;
+	for(count = 0; count < num_operations; count++)
+	{
+		// push more often than pop during the first half, and less often
+		// during the second
+		unsigned push_percent;
+		push_percent = count < num_operations / 2 ? 60 : 40;
+		if(size < max_size && (size == 0 || next_random(&state) % 100 < push_percent))
+		{
+			// values in a small range, so that there are duplicates
+			dtype value;
+			value = (dtype)(next_random(&state) % 1000) - 500;
+			check(heap_push(&heap, value) == 0, "heap_push");
+			reference[size++] = value;
+		}
+		else
+		{
+			dtype expected;
+			expected = reference_pop(reference, &size);
+			check(heap_top(&heap) == expected, "heap_top returns the largest element");
+			check(heap_pop(&heap) == expected, "heap_pop returns the largest element");
+		}
+		check(heap.size == size, "size of the priority queue");
+		check(heap.size <= heap.capacity, "capacity of the priority queue");
+	}
+	check(heap.capacity >= 2 * initial_capacity, "capacity grows");
+	while(size > 0)
+	{
+		dtype expected;
+		expected = reference_pop(reference, &size);
+		check(heap_pop(&heap) == expected, "heap_pop empties the priority queue in order");
+	}
+	check(heap.size == 0, "priority queue is empty");
+	heap_free(&heap);
+
+	// a full priority queue which cannot grow any further refuses the element
+	// without touching its storage
+	heap.data = heap.storage = NULL;
+	heap.size = heap.capacity = INT_MAX;
+	check(heap_push(&heap, 0) == 1, "heap_push fails at the largest capacity");
+	check(heap.size == INT_MAX, "size unchanged by a failed heap_push");
+}
+
+// check heap sort against qsort
+// sizes around the square of the arity decide whether leading elements are
+// left out of the heap, and offsets from an aligned buffer decide how many
+void test_heap_sort(void)
+{
+	static int const sizes[] = {0, 1, 2, 3, 4, 5, 15, 16, 17, 18, 20, 31, 32, 33, 64, 65, 1000, 4099};
+	int max_array_size;
+	max_array_size = 4099;
+	dtype *buffer, *expected;
+	buffer = aligned_alloc(64, 64 * (max_array_size / 16 + 2));
+	expected = malloc(max_array_size * sizeof *expected);
+	check(buffer != NULL && expected != NULL, "allocation");
+	unsigned state;
+	state = 2;
+	int offset;
+	for(offset = 0; offset < 4; offset++)
+	{
+		size_t count;
+		for(count = 0; count < sizeof sizes / sizeof *sizes; count++)
+		{
+			int size, range;
+			size = sizes[count];
+			for(range = 4; range <= 1 << 20; range <<= 8)
+			{
+				dtype *array;
+				array = buffer + offset;
+				int index;
+				for(index = 0; index < size; index++)
+				{
+					array[index] = (dtype)(next_random(&state) % range) - range / 2;
+				}
+				memcpy(expected, array, size * sizeof *expected);
+				qsort(expected, size, sizeof *expected, compare);
+				check(heap_sort(array, size) == 0, "heap_sort");
+				check(size == 0 || memcmp(array, expected, size * sizeof *array) == 0, "heap_sort sorts");
+			}
+		}
+	}
+	free(expected);
+	free(buffer);
+}
+
+int main(void)
+{
+	test_heap();
+	printf("priority queue: ok\n");
+	test_heap_sort();
+	printf("heap sort: ok\n");
+	return EXIT_SUCCESS;
+}